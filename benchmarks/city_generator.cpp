@@ -0,0 +1,278 @@
+#include "city_generator.h"
+
+#include "geo.h"
+#include "json.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace city_generator {
+
+    namespace {
+        //Сетка города: около 400 м между соседними узлами, сдвиг узла — до трети шага
+        constexpr double BASE_LATITUDE = 55.8;
+        constexpr double BASE_LONGITUDE = 37.4;
+        constexpr double GRID_STEP = 0.004;
+        constexpr double JITTER = GRID_STEP / 3;
+        //Дорога длиннее расстояния по прямой в 1.1–1.4 раза
+        constexpr double MIN_DETOUR = 1.1;
+        constexpr double MAX_DETOUR = 1.4;
+
+        std::string StopName(size_t index) {
+            return "Stop " + std::to_string(index);
+        }
+
+        std::string BusName(size_t index) {
+            return "Bus " + std::to_string(index);
+        }
+
+        class City {
+        public:
+            City(const Params& params, std::mt19937_64& random)
+                    : params_(params)
+                    , random_(random)
+                    , side_(static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(params.stops)))))
+                    , distances_(params.stops) {
+                std::uniform_real_distribution<double> jitter(-JITTER, JITTER);
+                coordinates_.reserve(params.stops);
+                for (size_t i = 0; i < params.stops; ++i) {
+                    coordinates_.push_back({BASE_LATITUDE - static_cast<double>(i / side_) * GRID_STEP + jitter(random_),
+                                            BASE_LONGITUDE + static_cast<double>(i % side_) * GRID_STEP + jitter(random_)});
+                }
+                std::bernoulli_distribution roundtrip(params.roundtrip_ratio);
+                routes_.reserve(params.buses);
+                for (size_t i = 0; i < params.buses; ++i) {
+                    routes_.push_back(Walk(roundtrip(random_)));
+                }
+            }
+
+            void Write(json::Writer& writer) const {
+                for (size_t i = 0; i < coordinates_.size(); ++i) {
+                    writer.StartDict();
+                    writer.Key("type");
+                    writer.String("Stop");
+                    writer.Key("name");
+                    writer.String(StopName(i));
+                    writer.Key("latitude");
+                    writer.Double(coordinates_[i].lat);
+                    writer.Key("longitude");
+                    writer.Double(coordinates_[i].lng);
+                    writer.Key("road_distances");
+                    writer.StartDict();
+                    for (const auto& [to, meters] : distances_[i]) {
+                        writer.Key(StopName(to));
+                        writer.Int(meters);
+                    }
+                    writer.EndDict();
+                    writer.EndDict();
+                }
+                for (size_t i = 0; i < routes_.size(); ++i) {
+                    writer.StartDict();
+                    writer.Key("type");
+                    writer.String("Bus");
+                    writer.Key("name");
+                    writer.String(BusName(i));
+                    writer.Key("stops");
+                    writer.StartArray();
+                    for (const size_t stop : routes_[i].stops) {
+                        writer.String(StopName(stop));
+                    }
+                    writer.EndArray();
+                    writer.Key("is_roundtrip");
+                    writer.Bool(routes_[i].is_roundtrip);
+                    writer.EndDict();
+                }
+            }
+
+        private:
+            struct Route {
+                std::vector<size_t> stops;
+                bool is_roundtrip = false;
+            };
+
+            const Params& params_;
+            std::mt19937_64& random_;
+            const size_t side_;
+            std::vector<geo::Coordinates> coordinates_;
+            std::vector<std::map<size_t, int>> distances_; // расстояния от остановки до следующих по маршрутам
+            std::vector<Route> routes_;
+
+            //Соседи узла сетки по горизонтали и вертикали
+            std::vector<size_t> Neighbours(size_t stop) const {
+                std::vector<size_t> result;
+                const size_t row = stop / side_;
+                const size_t column = stop % side_;
+                if (row > 0) {
+                    result.push_back(stop - side_);
+                }
+                if (stop + side_ < params_.stops) {
+                    result.push_back(stop + side_);
+                }
+                if (column > 0) {
+                    result.push_back(stop - 1);
+                }
+                if (column + 1 < side_ && stop + 1 < params_.stops) {
+                    result.push_back(stop + 1);
+                }
+                return result;
+            }
+
+            //Блуждание без разворотов на месте; кольцевой маршрут возвращается в начало
+            Route Walk(bool is_roundtrip) {
+                Route route{{std::uniform_int_distribution<size_t>(0, params_.stops - 1)(random_)}, is_roundtrip};
+                const size_t length = std::max<size_t>(params_.route_length, 2) - (is_roundtrip ? 1 : 0);
+                while (route.stops.size() < length) {
+                    std::vector<size_t> next = Neighbours(route.stops.back());
+                    if (route.stops.size() > 1 && next.size() > 1) {
+                        next.erase(std::remove(next.begin(), next.end(), route.stops[route.stops.size() - 2]), next.end());
+                    }
+                    if (next.empty()) {
+                        break;
+                    }
+                    route.stops.push_back(next[std::uniform_int_distribution<size_t>(0, next.size() - 1)(random_)]);
+                }
+                if (is_roundtrip) {
+                    route.stops.push_back(route.stops.front());
+                }
+                for (size_t i = 0; i + 1 < route.stops.size(); ++i) {
+                    AddDistance(route.stops[i], route.stops[i + 1]);
+                }
+                return route;
+            }
+
+            void AddDistance(size_t from, size_t to) {
+                if (distances_[from].count(to)) {
+                    return;
+                }
+                const double detour = std::uniform_real_distribution<double>(MIN_DETOUR, MAX_DETOUR)(random_);
+                const double meters = geo::ComputeDistance(coordinates_[from], coordinates_[to]) * detour;
+                distances_[from][to] = std::max(1, static_cast<int>(std::lround(meters)));
+            }
+        };
+
+        void WriteSettings(json::Writer& writer) {
+            writer.Key("render_settings");
+            writer.StartDict();
+            writer.Key("width");
+            writer.Double(1200.0);
+            writer.Key("height");
+            writer.Double(1200.0);
+            writer.Key("padding");
+            writer.Double(50.0);
+            writer.Key("line_width");
+            writer.Double(14.0);
+            writer.Key("stop_radius");
+            writer.Double(5.0);
+            writer.Key("bus_label_font_size");
+            writer.Int(20);
+            writer.Key("bus_label_offset");
+            writer.StartArray();
+            writer.Double(7.0);
+            writer.Double(15.0);
+            writer.EndArray();
+            writer.Key("stop_label_font_size");
+            writer.Int(20);
+            writer.Key("stop_label_offset");
+            writer.StartArray();
+            writer.Double(7.0);
+            writer.Double(-3.0);
+            writer.EndArray();
+            writer.Key("underlayer_color");
+            writer.StartArray();
+            writer.Int(255);
+            writer.Int(255);
+            writer.Int(255);
+            writer.Double(0.85);
+            writer.EndArray();
+            writer.Key("underlayer_width");
+            writer.Double(3.0);
+            writer.Key("color_palette");
+            writer.StartArray();
+            writer.String("green");
+            writer.String("red");
+            writer.String("blue");
+            writer.String("orange");
+            writer.EndArray();
+            writer.EndDict();
+
+            writer.Key("routing_settings");
+            writer.StartDict();
+            writer.Key("bus_wait_time");
+            writer.Int(6);
+            writer.Key("bus_velocity");
+            writer.Double(40.0);
+            writer.EndDict();
+        }
+
+        void WriteRequests(json::Writer& writer, const Params& params, std::mt19937_64& random) {
+            const RequestMix& mix = params.mix;
+            std::discrete_distribution<int> type({mix.bus, mix.stop, mix.route, mix.map});
+            std::uniform_int_distribution<size_t> stop(0, params.stops - 1);
+            std::uniform_int_distribution<size_t> bus(0, params.buses - 1);
+            writer.Key("stat_requests");
+            writer.StartArray();
+            for (size_t id = 0; id < params.requests; ++id) {
+                writer.StartDict();
+                writer.Key("id");
+                writer.Int(static_cast<int>(id));
+                writer.Key("type");
+                switch (type(random)) {
+                    case 0:
+                        writer.String("Bus");
+                        writer.Key("name");
+                        writer.String(BusName(bus(random)));
+                        break;
+                    case 1:
+                        writer.String("Stop");
+                        writer.Key("name");
+                        writer.String(StopName(stop(random)));
+                        break;
+                    case 2:
+                        writer.String("Route");
+                        writer.Key("from");
+                        writer.String(StopName(stop(random)));
+                        writer.Key("to");
+                        writer.String(StopName(stop(random)));
+                        break;
+                    default:
+                        writer.String("Map");
+                        break;
+                }
+                writer.EndDict();
+            }
+            writer.EndArray();
+        }
+    }//namespace
+
+    std::string Generate(const Params& params) {
+        if (params.stops == 0 || params.buses == 0) {
+            throw std::invalid_argument("City must have stops and buses");
+        }
+        const RequestMix& mix = params.mix;
+        if (params.requests > 0 && !(mix.bus + mix.stop + mix.route + mix.map > 0.0)) {
+            throw std::invalid_argument("Request mix must not be empty");
+        }
+        std::mt19937_64 random(params.seed);
+        const City city(params, random);
+
+        std::ostringstream out;
+        {
+            json::Writer writer(out, json::Writer::Format::COMPACT, json::Writer::DoubleFormat::SHORTEST);
+            writer.StartDict();
+            writer.Key("base_requests");
+            writer.StartArray();
+            city.Write(writer);
+            writer.EndArray();
+            WriteSettings(writer);
+            WriteRequests(writer, params, random);
+            writer.EndDict();
+        }
+        return out.str();
+    }
+
+}//namespace city_generator
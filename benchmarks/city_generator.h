@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Детерминированный генератор синтетических городов для бенчмарков.
+// Остановки расставлены по квадратной сетке со случайным сдвигом, маршруты — случайные блуждания
+// по соседним узлам сетки, поэтому линии и расстояния похожи на настоящую уличную сеть.
+// Одинаковые параметры всегда дают одинаковый документ
+namespace city_generator {
+
+    // Доли запросов каждого типа в stat_requests; нули исключают тип
+    struct RequestMix {
+        double bus = 4.0;
+        double stop = 4.0;
+        double route = 2.0;
+        double map = 0.0;
+    };
+
+    struct Params {
+        size_t stops = 1000;
+        size_t buses = 100;
+        size_t route_length = 20; // остановок в маршруте без обратного пути
+        double roundtrip_ratio = 0.5;
+        size_t requests = 10000;
+        RequestMix mix;
+        uint64_t seed = 1;
+    };
+
+    // Входной документ целиком: base_requests, render_settings, routing_settings и stat_requests
+    std::string Generate(const Params& params);
+
+}//namespace city_generator
@@ -0,0 +1,294 @@
+// Сквозной бенчмарк справочника на синтетических городах растущего размера.
+// Для каждого размера из --sweep по очереди измеряются фазы:
+//   generate  — генерация входного JSON;
+//   json_load — разбор документа в дерево json::Load;
+//   catalogue — чтение base_requests курсором в TransportCatalogue;
+//   router    — построение TransportRouter (предподсчёт всех маршрутов, O(V^3) по времени и O(V^2) по памяти,
+//               поэтому выше --router-limit остановок пропускается вместе с запросами Route);
+//   requests  — ответы RequestHandler на stat_requests, выведенные AnswerWriter в пустой поток.
+// Каждый размер измеряется в отдельном процессе, так что пиковый RSS относится только к нему,
+// а падение на большом городе (например, нехватка памяти) видно в отчёте и не прерывает остальные
+
+#include "city_generator.h"
+
+#include "answer_writer.h"
+#include "json.h"
+#include "json_reader.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    using namespace std::string_view_literals;
+
+    struct Options {
+        std::vector<size_t> sweep{1000, 2000, 5000, 10000, 20000, 50000}; // --sweep: размеры города в остановках
+        double buses_per_stop = 0.1;  // --buses-per-stop
+        size_t route_length = 20;     // --route-length
+        double roundtrip_ratio = 0.5; // --roundtrip
+        size_t requests = 20000;      // --requests
+        city_generator::RequestMix mix; // --mix bus:4,stop:4,route:2,map:0
+        size_t threads = parallel::DefaultThreadCount(); // --threads
+        size_t router_limit = 2000;   // --router-limit: наибольший город, для которого строится маршрутизатор
+        uint64_t seed = 1;            // --seed
+    };
+
+    std::vector<size_t> ParseSizes(std::string_view text) {
+        std::vector<size_t> sizes;
+        while (!text.empty()) {
+            const size_t comma = std::min(text.find(','), text.size());
+            sizes.push_back(std::stoul(std::string(text.substr(0, comma))));
+            if (sizes.back() == 0) {
+                throw std::invalid_argument("--sweep sizes must be positive");
+            }
+            text.remove_prefix(std::min(comma + 1, text.size()));
+        }
+        return sizes;
+    }
+
+    city_generator::RequestMix ParseMix(std::string_view text) {
+        city_generator::RequestMix mix{0.0, 0.0, 0.0, 0.0};
+        while (!text.empty()) {
+            const size_t comma = std::min(text.find(','), text.size());
+            const std::string_view item = text.substr(0, comma);
+            const size_t colon = item.find(':');
+            if (colon == std::string_view::npos) {
+                throw std::invalid_argument("--mix items must look like type:weight");
+            }
+            const std::string_view type = item.substr(0, colon);
+            const double weight = std::stod(std::string(item.substr(colon + 1)));
+            if (type == "bus"sv) {
+                mix.bus = weight;
+            } else if (type == "stop"sv) {
+                mix.stop = weight;
+            } else if (type == "route"sv) {
+                mix.route = weight;
+            } else if (type == "map"sv) {
+                mix.map = weight;
+            } else {
+                throw std::invalid_argument("Unknown request type in --mix: " + std::string(type));
+            }
+            text.remove_prefix(std::min(comma + 1, text.size()));
+        }
+        return mix;
+    }
+
+    Options ParseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Unknown argument or missing value: " + std::string(arg));
+            }
+            const std::string_view value = argv[++i];
+            if (arg == "--sweep"sv) {
+                options.sweep = ParseSizes(value);
+            } else if (arg == "--buses-per-stop"sv) {
+                options.buses_per_stop = std::stod(std::string(value));
+            } else if (arg == "--route-length"sv) {
+                options.route_length = std::stoul(std::string(value));
+            } else if (arg == "--roundtrip"sv) {
+                options.roundtrip_ratio = std::stod(std::string(value));
+            } else if (arg == "--requests"sv) {
+                options.requests = std::stoul(std::string(value));
+            } else if (arg == "--mix"sv) {
+                options.mix = ParseMix(value);
+            } else if (arg == "--threads"sv) {
+                options.threads = std::stoul(std::string(value));
+            } else if (arg == "--router-limit"sv) {
+                options.router_limit = std::stoul(std::string(value));
+            } else if (arg == "--seed"sv) {
+                options.seed = std::stoull(std::string(value));
+            } else {
+                throw std::invalid_argument("Unknown argument: " + std::string(arg));
+            }
+        }
+        if (options.threads == 0) {
+            throw std::invalid_argument("--threads must be positive");
+        }
+        if (options.roundtrip_ratio < 0.0 || options.roundtrip_ratio > 1.0) {
+            throw std::invalid_argument("--roundtrip must be in [0, 1]");
+        }
+        return options;
+    }
+
+    // Поток, который только считает выведенные байты
+    class CountingBuffer : public std::streambuf {
+    public:
+        size_t Count() const {
+            return count_;
+        }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                ++count_;
+            }
+            return ch;
+        }
+
+        std::streamsize xsputn(const char*, std::streamsize count) override {
+            count_ += static_cast<size_t>(count);
+            return count;
+        }
+
+    private:
+        size_t count_ = 0;
+    };
+
+    // Пиковый RSS процесса в мегабайтах
+    double PeakRssMb() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<double>(usage.ru_maxrss) / 1024.0; //в Linux ru_maxrss — в килобайтах
+    }
+
+    class Report {
+    public:
+        explicit Report(size_t stops)
+                : stops_(stops) {
+        }
+
+        // Печатает строку фазы: время, пропускная способность (count единиц unit в секунду) и пиковый RSS
+        void Phase(std::string_view phase, double seconds, double count, std::string_view unit) const {
+            std::ostringstream line;
+            line << std::setw(8) << stops_ << "  " << std::left << std::setw(10) << phase << std::right
+                 << std::fixed << std::setprecision(1) << std::setw(12) << seconds * 1000.0
+                 << std::setw(14) << (seconds > 0.0 ? count / seconds : 0.0) << ' ' << std::left << std::setw(10) << unit
+                 << std::right << std::setw(10) << PeakRssMb() << '\n';
+            std::cout << line.str() << std::flush;
+        }
+
+        void Skipped(std::string_view phase, std::string_view reason) const {
+            std::cout << std::setw(8) << stops_ << "  " << std::left << std::setw(10) << phase << std::right
+                      << "  skipped: " << reason << '\n' << std::flush;
+        }
+
+    private:
+        size_t stops_;
+    };
+
+    // Секундомер фазы
+    class Timer {
+    public:
+        double Seconds() const {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+    };
+
+    void RunCity(const Options& options, size_t stops) {
+        const Report report(stops);
+        const bool build_router = stops <= options.router_limit;
+
+        city_generator::Params params;
+        params.stops = stops;
+        params.buses = std::max<size_t>(1, static_cast<size_t>(static_cast<double>(stops) * options.buses_per_stop));
+        params.route_length = options.route_length;
+        params.roundtrip_ratio = options.roundtrip_ratio;
+        params.requests = options.requests;
+        params.mix = options.mix;
+        if (!build_router) {
+            params.mix.route = 0.0;
+        }
+        params.seed = options.seed;
+
+        Timer generate_timer;
+        const std::string input = city_generator::Generate(params);
+        const double megabytes = static_cast<double>(input.size()) / (1024.0 * 1024.0);
+        report.Phase("generate", generate_timer.Seconds(), megabytes, "MB/s");
+
+        {
+            Timer timer;
+            const json::Document document = json::Load(input);
+            report.Phase("json_load", timer.Seconds(), megabytes, "MB/s");
+        }
+
+        transport_catalogue::TransportCatalogue catalogue;
+        Timer catalogue_timer;
+        json::Cursor cursor(input);
+        json_reader::JsonReader reader(cursor, catalogue);
+        report.Phase("catalogue", catalogue_timer.Seconds(), static_cast<double>(stops + params.buses), "items/s");
+
+        //Без маршрутизатора обработчику достаточно пустого: запросы Route исключены из смеси
+        transport_catalogue::TransportCatalogue empty_catalogue;
+        Timer router_timer;
+        const TransportRouter router(build_router ? catalogue : empty_catalogue, reader.RouterSettingsReturn());
+        if (build_router) {
+            report.Phase("router", router_timer.Seconds(), static_cast<double>(stops), "stops/s");
+        } else {
+            report.Skipped("router", "more stops than --router-limit " + std::to_string(options.router_limit));
+        }
+
+        Timer requests_timer;
+        reader.ResolveStatRequests(catalogue);
+        request_handler::RequestHandler handler(catalogue, reader.RenderSettingsReturn(), router);
+        CountingBuffer buffer;
+        std::ostream output(&buffer);
+        json_reader::AnswerWriter writer(output, reader.RouterSettingsReturn());
+        handler.ProcessRequests(reader.StatRequestsReturn(), options.threads,
+                                [&writer](int id, const request_handler::RequestHandler::Answer& answer) {
+                                    writer.Write(id, answer);
+                                });
+        writer.Finish();
+        report.Phase("requests", requests_timer.Seconds(), static_cast<double>(reader.StatRequestsReturn().size()),
+                     "req/s");
+    }
+}//namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        std::cout << std::setw(8) << "stops" << "  " << std::left << std::setw(10) << "phase" << std::right
+                  << std::setw(12) << "time_ms" << std::setw(14) << "throughput" << ' ' << std::left << std::setw(10)
+                  << "unit" << std::right << std::setw(10) << "rss_mb" << '\n' << std::flush;
+        int failures = 0;
+        for (const size_t stops : options.sweep) {
+            const pid_t child = fork();
+            if (child < 0) {
+                throw std::runtime_error("fork failed");
+            }
+            if (child == 0) {
+                int code = 0;
+                try {
+                    RunCity(options, stops);
+                } catch (const std::exception& e) {
+                    std::cerr << stops << ": " << e.what() << std::endl;
+                    code = 1;
+                }
+                std::cout.flush();
+                _exit(code);
+            }
+            int status = 0;
+            waitpid(child, &status, 0);
+            if (WIFSIGNALED(status)) {
+                std::cout << std::setw(8) << stops << "  failed: signal " << WTERMSIG(status) << '\n';
+                ++failures;
+            } else if (WEXITSTATUS(status) != 0) {
+                std::cout << std::setw(8) << stops << "  failed: exit code " << WEXITSTATUS(status) << '\n';
+                ++failures;
+            }
+        }
+        return failures == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,119 @@
+// Снимок справочника: справочник, загруженный из снимка, отвечает на запросы так же, как разобранный из JSON.
+// Маршруты с равным временем различаются только порядком остановок и маршрутов, поэтому в базе
+// есть такая пара (от Biryulyovo Zapadnoye до Prazhskaya через Universam или Biryulyovo Tovarnaya)
+
+#include "answer_writer.h"
+#include "catalogue_snapshot.h"
+#include "json.h"
+#include "json_reader.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+    using namespace std::string_view_literals;
+    using transport_catalogue::TransportCatalogue;
+
+    constexpr std::string_view BASE = R"({
+  "base_requests": [
+    {"is_roundtrip": true, "name": "297", "stops": ["Biryulyovo Zapadnoye", "Biryulyovo Tovarnaya", "Universam", "Biryulyovo Zapadnoye"], "type": "Bus"},
+    {"is_roundtrip": false, "name": "635", "stops": ["Biryulyovo Tovarnaya", "Universam", "Prazhskaya"], "type": "Bus"},
+    {"latitude": 55.574371, "longitude": 37.6517, "name": "Biryulyovo Zapadnoye", "road_distances": {"Biryulyovo Tovarnaya": 2600}, "type": "Stop"},
+    {"latitude": 55.587655, "longitude": 37.645687, "name": "Universam", "road_distances": {"Biryulyovo Tovarnaya": 1380, "Biryulyovo Zapadnoye": 2500, "Prazhskaya": 4650}, "type": "Stop"},
+    {"latitude": 55.592028, "longitude": 37.653656, "name": "Biryulyovo Tovarnaya", "road_distances": {"Universam": 890}, "type": "Stop"},
+    {"latitude": 55.611717, "longitude": 37.603938, "name": "Prazhskaya", "road_distances": {}, "type": "Stop"},
+    {"latitude": 55.6, "longitude": 37.6, "name": "Lonely \"quoted\" -> stop", "road_distances": {}, "type": "Stop"}
+  ],
+  "render_settings": {
+    "bus_label_font_size": 20, "bus_label_offset": [7, 15], "color_palette": ["green", [255, 160, 0], "red"],
+    "height": 200, "line_width": 14, "padding": 30, "stop_label_font_size": 20, "stop_label_offset": [7, -3],
+    "stop_radius": 5, "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3, "width": 200
+  },
+  "routing_settings": {"bus_velocity": 30, "bus_wait_time": 2},
+  "stat_requests": [
+    {"id": 1, "name": "297", "type": "Bus"},
+    {"id": 2, "name": "635", "type": "Bus"},
+    {"id": 3, "name": "Universam", "type": "Stop"},
+    {"id": 4, "from": "Biryulyovo Zapadnoye", "to": "Prazhskaya", "type": "Route"},
+    {"id": 5, "from": "Prazhskaya", "to": "Biryulyovo Zapadnoye", "type": "Route"},
+    {"id": 6, "from": "Biryulyovo Zapadnoye", "to": "Universam", "type": "Route"},
+    {"id": 7, "from": "Prazhskaya", "to": "Lonely \"quoted\" -> stop", "type": "Route"},
+    {"id": 8, "type": "Map"}
+  ]
+})"sv;
+
+    int failures = 0;
+
+    void Check(bool condition, std::string_view message) {
+        if (!condition) {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    std::string Answer(const TransportCatalogue& catalogue, json_reader::JsonReader& reader) {
+        const TransportRouter router(catalogue, reader.RouterSettingsReturn());
+        const request_handler::RequestHandler handler(catalogue, reader.RenderSettingsReturn(), router, 1);
+        std::vector<StatRequest> requests = reader.StatRequestsReturn();
+        std::ostringstream out;
+        {
+            json_reader::AnswerWriter writer(out, reader.RouterSettingsReturn());
+            for (auto& request : requests) {
+                catalogue.Resolve(request);
+                writer.Write(request.id, handler.ProcessRequest(request));
+            }
+            writer.Finish();
+        }
+        return out.str();
+    }
+
+    void TestSnapshotKeepsAnswers() {
+        TransportCatalogue parsed;
+        json::Cursor cursor(BASE);
+        json_reader::JsonReader reader(cursor, parsed);
+
+        const std::string path = "catalogue_snapshot_test.bin";
+        const uint64_t hash = transport_catalogue::snapshot::ComputeSourceHash(BASE);
+        transport_catalogue::snapshot::Save(parsed, hash, path);
+
+        TransportCatalogue loaded;
+        {
+            const transport_catalogue::snapshot::MappedSnapshot snapshot(path);
+            Check(snapshot.GetSourceHash() == hash, "source hash is kept");
+            snapshot.LoadInto(loaded);
+        }
+        std::remove(path.c_str());
+
+        Check(loaded.GetStopsById().size() == parsed.GetStopsById().size(), "stop count");
+        for (size_t id = 0; id < parsed.GetStopsById().size() && id < loaded.GetStopsById().size(); ++id) {
+            Check(loaded.GetStopsById()[id]->stop_name == parsed.GetStopsById()[id]->stop_name, "stop order");
+            Check(loaded.GetStopsById()[id]->id == id, "stop id");
+        }
+        Check(loaded.GetBusesInOrder().size() == parsed.GetBusesInOrder().size(), "bus count");
+        for (size_t i = 0; i < parsed.GetBusesInOrder().size() && i < loaded.GetBusesInOrder().size(); ++i) {
+            Check(loaded.GetBusesInOrder()[i]->bus_name == parsed.GetBusesInOrder()[i]->bus_name, "bus order");
+        }
+
+        const std::string expected = Answer(parsed, reader);
+        const std::string actual = Answer(loaded, reader);
+        Check(expected == actual, "answers of the loaded catalogue");
+        if (expected != actual) {
+            std::cerr << "parsed:\n" << expected << "\nloaded:\n" << actual << std::endl;
+        }
+    }
+}//namespace
+
+int main() {
+    TestSnapshotKeepsAnswers();
+    if (failures != 0) {
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,304 @@
+// Разборы JSON согласованы: json::Load, курсор, потоковое чтение и арена принимают одни и те же документы,
+// строят из них одно и то же и отклоняют одни и те же ошибки, в том числе предел вложенности и числа,
+// которые не помещаются в double
+
+#include "json.h"
+#include "json_arena.h"
+#include "json_scan.h"
+
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+
+    int failures = 0;
+
+    void Check(bool condition, std::string_view message) {
+        if (!condition) {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    //Курсор обходит значение поэлементно; числа он читает как double
+    json::Node Walk(json::Cursor& cursor) {
+        switch (cursor.Peek()) {
+            case json::Cursor::Type::OBJECT: {
+                cursor.BeginObject();
+                json::Dict dict;
+                std::string_view key;
+                while (cursor.NextKey(key)) {
+                    std::string name(key);
+                    dict.emplace(std::move(name), Walk(cursor));
+                }
+                return dict;
+            }
+            case json::Cursor::Type::ARRAY: {
+                cursor.BeginArray();
+                json::Array array;
+                while (cursor.NextElement()) {
+                    array.push_back(Walk(cursor));
+                }
+                return array;
+            }
+            case json::Cursor::Type::STRING:
+                return std::string(cursor.ReadString());
+            case json::Cursor::Type::BOOL:
+                return cursor.ReadBool();
+            case json::Cursor::Type::NUMBER:
+                return cursor.ReadDouble();
+            case json::Cursor::Type::NULL_VALUE:
+                cursor.Skip();
+                return nullptr;
+        }
+        return nullptr;
+    }
+
+    json::Node FromArena(const json::arena::Value& value) {
+        if (value.IsArray()) {
+            json::Array array;
+            for (const auto& item : value.AsArray()) {
+                array.push_back(FromArena(item));
+            }
+            return array;
+        }
+        if (value.IsMap()) {
+            json::Dict dict;
+            for (const auto& [key, item] : value.AsMap()) {
+                dict.emplace(std::string(key), FromArena(item));
+            }
+            return dict;
+        }
+        if (value.IsInt()) {
+            return value.AsInt();
+        }
+        if (value.IsPureDouble()) {
+            return value.AsDouble();
+        }
+        if (value.IsBool()) {
+            return value.AsBool();
+        }
+        if (value.IsString()) {
+            return std::string(value.AsString());
+        }
+        return nullptr;
+    }
+
+    //Совпадение с точностью до представления чисел: курсор не различает int и double
+    bool SameValues(const json::Node& left, const json::Node& right) {
+        if (left.IsDouble() && right.IsDouble()) {
+            return left.AsDouble() == right.AsDouble();
+        }
+        if (left.IsArray() && right.IsArray()) {
+            const auto& a = left.AsArray();
+            const auto& b = right.AsArray();
+            if (a.size() != b.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < a.size(); ++i) {
+                if (!SameValues(a[i], b[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        if (left.IsMap() && right.IsMap()) {
+            const auto& a = left.AsMap();
+            const auto& b = right.AsMap();
+            if (a.size() != b.size()) {
+                return false;
+            }
+            for (auto it = a.begin(), jt = b.begin(); it != a.end(); ++it, ++jt) {
+                if (it->first != jt->first || !SameValues(it->second, jt->second)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return left == right;
+    }
+
+    json::Node ViaStream(std::string_view text) {
+        std::istringstream input{std::string(text)};
+        json::StreamReader reader(input);
+        json::Node value = reader.ReadValue();
+        reader.Finish();
+        return value;
+    }
+
+    json::Node ViaStreamCursor(std::string_view text) {
+        std::istringstream input{std::string(text)};
+        json::StreamReader reader(input);
+        json::Node value;
+        reader.ReadValue([&value](json::Cursor& cursor) {
+            value = Walk(cursor);
+        });
+        reader.Finish();
+        return value;
+    }
+
+    json::Node ViaCursor(std::string_view text) {
+        json::Cursor cursor(text);
+        json::Node value = Walk(cursor);
+        cursor.Finish();
+        return value;
+    }
+
+    json::Node ViaCursorValue(std::string_view text) {
+        json::Cursor cursor(text);
+        json::Node value = cursor.ReadValue();
+        cursor.Finish();
+        return value;
+    }
+
+    json::Node ViaCursorSkip(std::string_view text) {
+        json::Cursor cursor(text);
+        cursor.Skip();
+        cursor.Finish();
+        return nullptr;
+    }
+
+    json::Node ViaArena(std::string_view text) {
+        const json::arena::Document doc{std::string(text)};
+        return FromArena(doc.GetRoot());
+    }
+
+    struct Reader {
+        std::string_view name;
+        std::function<json::Node(std::string_view)> read;
+        bool exact; // числа различаются по типу, как в json::Load
+    };
+
+    const Reader READERS[] = {
+        {"StreamReader::ReadValue"sv, ViaStream, true},
+        {"StreamReader::ReadValue(cursor)"sv, ViaStreamCursor, false},
+        {"Cursor"sv, ViaCursor, false},
+        {"Cursor::ReadValue"sv, ViaCursorValue, true},
+        {"arena::Document"sv, ViaArena, true},
+    };
+
+    void CheckAccepted(std::string_view text) {
+        const std::string where = " for "s + std::string(text.substr(0, 60));
+        json::Node expected;
+        try {
+            expected = json::Load(text).GetRoot();
+        } catch (const json::ParsingError& error) {
+            Check(false, "json::Load rejected a valid document: "s + error.what() + where);
+            return;
+        }
+        for (const auto& reader : READERS) {
+            try {
+                const json::Node value = reader.read(text);
+                Check(reader.exact ? value == expected : SameValues(value, expected),
+                      std::string(reader.name) + " builds a different value"s + where);
+            } catch (const json::ParsingError& error) {
+                Check(false, std::string(reader.name) + " rejected a valid document: "s + error.what() + where);
+            }
+        }
+        try {
+            ViaCursorSkip(text);
+        } catch (const json::ParsingError& error) {
+            Check(false, "Cursor::Skip rejected a valid document: "s + error.what() + where);
+        }
+    }
+
+    //Все разборы отклоняют документ; разборы, построенные на общем сканере, указывают одно смещение
+    void CheckRejected(std::string_view text) {
+        const std::string where = " for "s + std::string(text.substr(0, 60));
+        std::optional<size_t> expected_offset;
+        try {
+            json::Load(text);
+            Check(false, "json::Load accepted an invalid document"s + where);
+        } catch (const json::ParsingError& error) {
+            expected_offset = error.Offset();
+        }
+        auto check_reader = [&](std::string_view name, const std::function<json::Node(std::string_view)>& read,
+                                bool same_offset) {
+            try {
+                read(text);
+                Check(false, std::string(name) + " accepted an invalid document"s + where);
+            } catch (const json::ParsingError& error) {
+                if (same_offset && expected_offset) {
+                    Check(error.Offset() == *expected_offset,
+                          std::string(name) + " reports offset "s + std::to_string(error.Offset()) + " instead of "s
+                          + std::to_string(*expected_offset) + where);
+                }
+            }
+        };
+        for (const auto& reader : READERS) {
+            check_reader(reader.name, reader.read, reader.exact);
+        }
+        check_reader("Cursor::Skip"sv, ViaCursorSkip, false);
+    }
+
+    std::string Nested(size_t depth) {
+        return std::string(depth, '[') + std::string(depth, ']');
+    }
+
+    void TestValidDocuments() {
+        for (const std::string_view text : {
+                "null"sv, "true"sv, " false "sv, "0"sv, "-0"sv, "42"sv, "-2147483648"sv, "2147483647"sv,
+                "2147483648"sv, "1.5"sv, "-0.25e-3"sv, "1E+2"sv, "1e308"sv, "4.9e-324"sv,
+                R"("")"sv, R"("plain")"sv, R"("esc \" \\ \n \r \t")"sv,
+                "[]"sv, "{}"sv, " [ 1 , [ 2 , { } ] , \"x\" ] "sv,
+                R"({"b": 1, "a": [true, null, 2.5], "c": {"d": "e\n"}})"sv,
+                R"({"dup": 1, "dup": 2})"sv}) {
+            CheckAccepted(text);
+        }
+    }
+
+    void TestInvalidDocuments() {
+        for (const std::string_view text : {
+                ""sv, "   "sv, "nul"sv, "tru"sv, "nulll"sv, "01"sv, "-"sv, "1."sv, ".5"sv, "1e"sv, "+1"sv,
+                "1e400"sv, "-1e400"sv, "[1e400]"sv, R"({"a": 1e400})"sv,
+                R"("unterminated)"sv, R"("bad \x escape")"sv, R"("\/")"sv, R"("\)"sv,
+                "[1, 2"sv, "[1 2]"sv, "[1,]"sv, R"({"a" 1})"sv, R"({"a": 1,})"sv, R"({1: 2})"sv,
+                "[] []"sv, "1 2"sv, R"({"a": 1}})"sv, "]"sv}) {
+            CheckRejected(text);
+        }
+    }
+
+    void TestDepthLimit() {
+        CheckAccepted(Nested(json::detail::MAX_DEPTH));
+        CheckRejected(Nested(json::detail::MAX_DEPTH + 1));
+        CheckAccepted("{\"a\":"s + Nested(json::detail::MAX_DEPTH - 1) + "}"s);
+        CheckRejected("{\"a\":"s + Nested(json::detail::MAX_DEPTH) + "}"s);
+    }
+
+    //Потоковое чтение дочитывает вход блоками: значения и ошибки на границах блоков
+    void TestLargeDocument() {
+        std::string text = "["s;
+        for (int i = 0; i < 20000; ++i) {
+            text += i % 3 == 0 ? std::to_string(i) : i % 3 == 1 ? std::to_string(i) + ".5"s : "\"s\\\"t\\n"s + std::to_string(i) + "\""s;
+            text += ", "sv;
+        }
+        text += "{\"last\": [null, false]}]"sv;
+        CheckAccepted(text);
+
+        std::string broken = text;
+        broken.replace(broken.rfind("null"sv), 4, "1e400"sv);
+        CheckRejected(broken);
+        broken = text;
+        broken[broken.find(',', broken.size() / 2)] = '#';
+        CheckRejected(broken);
+    }
+
+}//namespace
+
+int main() {
+    TestValidDocuments();
+    TestInvalidDocuments();
+    TestDepthLimit();
+    TestLargeDocument();
+    if (failures != 0) {
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
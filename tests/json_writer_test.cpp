@@ -0,0 +1,238 @@
+// Вывод json::Writer побайтно совпадает с прежним выводом через std::ostream: числа double в формате
+// operator<< по умолчанию, экранируются только \n, \r, \t, \\ и ", остальные байты выводятся как есть.
+// Эталон ниже повторяет прежний PrintNode; с ним сравниваются Writer в обоих форматах и Print
+
+#include "json.h"
+
+#include <cmath>
+#include <charconv>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+
+    int failures = 0;
+
+    void Check(bool condition, std::string_view message) {
+        if (!condition) {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    void PrintReferenceString(std::string_view value, std::ostream& out) {
+        out << '"';
+        for (const char ch : value) {
+            switch (ch) {
+                case '\n': out << "\\n"; break;
+                case '\r': out << "\\r"; break;
+                case '\t': out << "\\t"; break;
+                case '\\': out << "\\\\"; break;
+                case '"': out << "\\\""; break;
+                default: out << ch;
+            }
+        }
+        out << '"';
+    }
+
+    void PrintReference(const json::Node& node, std::ostream& out, bool compact) {
+        if (node.IsNull()) {
+            out << "null";
+        } else if (node.IsBool()) {
+            out << (node.AsBool() ? "true" : "false");
+        } else if (node.IsInt()) {
+            out << node.AsInt();
+        } else if (node.IsPureDouble()) {
+            out << node.AsDouble();
+        } else if (node.IsString()) {
+            PrintReferenceString(node.AsString(), out);
+        } else if (node.IsMap()) {
+            out << (compact ? "{" : "{\n");
+            bool is_first = true;
+            for (const auto& [key, value] : node.AsMap()) {
+                if (!is_first) {
+                    out << (compact ? "," : ",\n");
+                }
+                PrintReferenceString(key, out);
+                out << (compact ? ":" : ": ");
+                PrintReference(value, out, compact);
+                is_first = false;
+            }
+            out << (compact ? "}" : "\n}");
+        } else if (node.IsArray()) {
+            out << (compact ? "[" : "[\n");
+            bool is_first = true;
+            for (const auto& item : node.AsArray()) {
+                if (!is_first) {
+                    out << (compact ? "," : ",\n");
+                }
+                PrintReference(item, out, compact);
+                is_first = false;
+            }
+            out << (compact ? "]" : "\n]");
+        }
+    }
+
+    std::string Reference(const json::Node& node, bool compact = false) {
+        std::ostringstream out;
+        PrintReference(node, out, compact);
+        return out.str();
+    }
+
+    std::string Written(const json::Node& node, json::Writer::Format format = json::Writer::Format::PRETTY) {
+        std::ostringstream out;
+        {
+            json::Writer writer(out, format);
+            writer.Value(node);
+        }
+        return out.str();
+    }
+
+    std::string Printed(const json::Node& node) {
+        std::ostringstream out;
+        json::Print(json::Document(node), out);
+        return out.str();
+    }
+
+    const double DOUBLES[] = {
+        0.0, -0.0, 1.0, -1.0, 0.5, 0.1, 1.0 / 3.0, -2.0 / 3.0, 3.14159265358979, 123456.0, 1234567.0, 999999.5,
+        1e-4, 1e-5, 0.000123456789, 1e21, 1.5e300, -2.5e-300, 4.9e-324, 55.574371, 37.6517, 27.6, 1e6, 100000.0,
+        std::numeric_limits<double>::max(), std::numeric_limits<double>::min(), 2147483648.0,
+    };
+
+    //Все байты, кроме нулевого
+    std::string AllBytes() {
+        std::string all_bytes;
+        for (int c = 1; c < 256; ++c) {
+            all_bytes += static_cast<char>(c);
+        }
+        return all_bytes;
+    }
+
+    void TestDoubles() {
+        for (const double value : DOUBLES) {
+            const json::Node node(value);
+            const std::string expected = Reference(node);
+            Check(Written(node) == expected, "Writer formats "s + expected + " as "s + Written(node));
+            Check(Printed(node) == expected, "Print formats "s + expected + " as "s + Printed(node));
+        }
+    }
+
+    void TestShortestDoubles() {
+        for (const double value : DOUBLES) {
+            std::ostringstream out;
+            {
+                json::Writer writer(out, json::Writer::Format::COMPACT, json::Writer::DoubleFormat::SHORTEST);
+                writer.Double(value);
+            }
+            const std::string text = out.str();
+            double parsed = 0;
+            const auto result = std::from_chars(text.data(), text.data() + text.size(), parsed);
+            Check(result.ec == std::errc{} && result.ptr == text.data() + text.size()
+                  && parsed == value && std::signbit(parsed) == std::signbit(value),
+                  "SHORTEST does not read back: "s + text);
+            Check(json::Load(text).GetRoot().AsDouble() == value, "SHORTEST is not valid JSON: "s + text);
+        }
+    }
+
+    //Экранируемые символы стоят в разных местах относительно 16-байтных блоков сканирования
+    void TestEscapes() {
+        const std::string all_bytes = AllBytes();
+        for (size_t offset = 0; offset < 40; ++offset) {
+            for (const std::string_view special : {"\n"sv, "\r"sv, "\t"sv, "\\"sv, "\""sv, "\x01"sv, "\xff"sv}) {
+                const std::string value = std::string(offset, 'a') + std::string(special) + std::string(offset % 17, 'b');
+                const json::Node node(value);
+                const std::string expected = Reference(node);
+                Check(Written(node) == expected, "Writer escapes differently at offset "s + std::to_string(offset));
+
+                std::string appended;
+                json::AppendEscaped(appended, value);
+                Check('"' + appended + '"' == expected, "AppendEscaped differs at offset "s + std::to_string(offset));
+            }
+        }
+
+        const json::Node node(all_bytes);
+        Check(Written(node) == Reference(node), "Writer escapes the byte range differently");
+
+        //EscapingBuffer получает текст кусками произвольной длины
+        std::string buffered;
+        {
+            json::EscapingBuffer buffer(buffered);
+            std::ostream out(&buffer);
+            out << all_bytes.substr(0, 7) << all_bytes[7] << all_bytes.substr(8);
+        }
+        Check('"' + buffered + '"' == Reference(node), "EscapingBuffer escapes the byte range differently");
+    }
+
+    json::Node SampleDocument() {
+        return json::Dict{
+            {"request_id"s, 12},
+            {"total_time"s, 24.216666666666665},
+            {"items"s, json::Array{
+                json::Dict{{"type"s, "Wait"s}, {"stop_name"s, "Biryulyovo \"Zapadnoye\"\n"s}, {"time"s, 6}},
+                json::Dict{{"type"s, "Bus"s}, {"bus"s, "297"s}, {"span_count"s, 2}, {"time"s, 5.235}},
+                json::Array{}, json::Dict{}, nullptr, true, false, -0.5,
+            }},
+            {"map"s, "<svg>\t\\</svg>"s},
+        };
+    }
+
+    void TestLayout() {
+        const json::Node document = SampleDocument();
+        Check(Written(document) == Reference(document), "Writer lays out the document differently");
+        Check(Printed(document) == Reference(document), "Print lays out the document differently");
+        Check(Written(document, json::Writer::Format::COMPACT) == Reference(document, true),
+              "Compact Writer lays out the document differently");
+
+        //Поэлементный вывод совпадает с выводом того же значения целиком
+        std::ostringstream out;
+        {
+            json::Writer writer(out);
+            writer.StartDict();
+            for (const auto& [key, value] : document.AsMap()) {
+                writer.Key(key);
+                if (value.IsArray()) {
+                    writer.StartArray();
+                    for (const auto& item : value.AsArray()) {
+                        writer.Value(item);
+                    }
+                    writer.EndArray();
+                } else {
+                    writer.Value(value);
+                }
+            }
+            writer.EndDict();
+        }
+        Check(out.str() == Reference(document), "Writer calls lay out the document differently");
+    }
+
+    //Документ больше порога сброса буфера выводится так же, как малый
+    void TestLargeDocument() {
+        json::Array items;
+        for (int i = 0; i < 20000; ++i) {
+            items.emplace_back(json::Dict{{"id"s, i}, {"value"s, i / 7.0}, {"name"s, "stop\t"s + std::to_string(i)}});
+        }
+        items.emplace_back(std::string(100000, '"'));
+        const json::Node document(std::move(items));
+        Check(Written(document) == Reference(document), "Writer differs on a large document");
+    }
+
+}//namespace
+
+int main() {
+    TestDoubles();
+    TestShortestDoubles();
+    TestEscapes();
+    TestLayout();
+    TestLargeDocument();
+    if (failures != 0) {
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
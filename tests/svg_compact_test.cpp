@@ -0,0 +1,294 @@
+// Компактный вывод SVG: координаты округляются до заданной точности, вершины ломаных после первой
+// выводятся смещениями от уже округлённой предыдущей вершины, поэтому ошибка вдоль пути не накапливается.
+// Обычный вывод плоского документа побайтно совпадает с svg::Document, а карта с compact_svg
+// и svg_precision в настройках содержит числа не длиннее svg_precision знаков после точки
+
+#include "answer_writer.h"
+#include "json.h"
+#include "json_reader.h"
+#include "request_handler.h"
+#include "svg.h"
+#include "svg_flat.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+    using transport_catalogue::TransportCatalogue;
+
+    int failures = 0;
+
+    void Check(bool condition, std::string_view message) {
+        if (!condition) {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    //Одна и та же картинка в плоском документе и в svg::Document
+    struct Scene {
+        svg::FlatDocument flat;
+        svg::Document document;
+        std::vector<svg::Point> circles;              // центр; радиус хранится в radii
+        std::vector<double> radii;
+        std::vector<std::vector<svg::Point>> polylines;
+        std::vector<svg::Point> texts;                // опорная точка вместе со смещением
+    };
+
+    Scene MakeScene() {
+        Scene scene;
+        std::mt19937 random(2024);
+        std::uniform_real_distribution<double> coordinate(-50.0, 1250.0);
+        auto point = [&]() {
+            return svg::Point{coordinate(random), coordinate(random)};
+        };
+
+        svg::Style line;
+        line.SetFillColor(svg::NoneColor).SetStrokeColor(svg::Rgb{255, 160, 0}).SetStrokeWidth(14.25)
+            .SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+        svg::Style fill;
+        fill.SetFillColor("white"s);
+        const svg::StyleId line_style = scene.flat.AddStyle(line);
+        const svg::StyleId fill_style = scene.flat.AddStyle(fill);
+        const svg::FontId font = scene.flat.AddFont({20, "Verdana"s, "bold"s});
+
+        for (int i = 0; i < 40; ++i) {
+            std::vector<svg::Point> points(3 + i % 17);
+            svg::Polyline polyline;
+            scene.flat.StartPolyline(line_style);
+            for (auto& vertex : points) {
+                vertex = point();
+                scene.flat.AddPoint(vertex);
+                polyline.AddPoint(vertex);
+            }
+            scene.document.Add(polyline.SetFillColor(svg::NoneColor).SetStrokeColor(svg::Rgb{255, 160, 0})
+                .SetStrokeWidth(14.25).SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND));
+            scene.polylines.push_back(std::move(points));
+
+            const svg::Point center = point();
+            const double radius = 5.0 + coordinate(random) / 1000.0;
+            scene.flat.AddCircle(center, radius, fill_style);
+            scene.document.Add(svg::Circle().SetCenter(center).SetRadius(radius).SetFillColor("white"s));
+            scene.circles.push_back(center);
+            scene.radii.push_back(radius);
+
+            const svg::Point position = point();
+            const svg::Point offset{7.0, -3.0};
+            const std::string data = "Stop <"s + std::to_string(i) + "> & \"co\""s;
+            scene.flat.AddText(position, offset, font, fill_style, data);
+            scene.document.Add(svg::Text().SetPosition(position).SetOffset(offset).SetFontSize(20)
+                .SetFontFamily("Verdana"s).SetFontWeight("bold"s).SetData(data).SetFillColor("white"s));
+            scene.texts.push_back({position.x + offset.x, position.y + offset.y});
+        }
+        return scene;
+    }
+
+    //Число вывода в единицах 10^-precision; false, если у него больше precision знаков после точки
+    bool ParseScaled(std::string_view text, int precision, int64_t& result) {
+        bool negative = false;
+        if (!text.empty() && text.front() == '-') {
+            negative = true;
+            text.remove_prefix(1);
+        }
+        int64_t value = 0;
+        int fraction_digits = -1;
+        for (const char c : text) {
+            if (c == '.' && fraction_digits < 0) {
+                fraction_digits = 0;
+            } else if (c >= '0' && c <= '9') {
+                value = value * 10 + (c - '0');
+                if (fraction_digits >= 0) {
+                    ++fraction_digits;
+                }
+            } else {
+                return false;
+            }
+        }
+        if (text.empty() || fraction_digits == 0 || fraction_digits > precision) {
+            return false;
+        }
+        for (int i = std::max(fraction_digits, 0); i < precision; ++i) {
+            value *= 10;
+        }
+        result = negative ? -value : value;
+        return true;
+    }
+
+    int64_t Expected(double value, int precision) {
+        return static_cast<int64_t>(std::round(value * std::pow(10.0, precision)));
+    }
+
+    std::vector<std::string> Matches(const std::string& text, const std::regex& pattern) {
+        std::vector<std::string> result;
+        for (auto it = std::sregex_iterator(text.begin(), text.end(), pattern); it != std::sregex_iterator(); ++it) {
+            for (size_t group = 1; group < it->size(); ++group) {
+                result.push_back((*it)[group].str());
+            }
+        }
+        return result;
+    }
+
+    void CheckNumber(const std::string& text, double expected, int precision, std::string_view what) {
+        int64_t scaled = 0;
+        const std::string where = std::string(what) + " "s + text + " at precision "s + std::to_string(precision);
+        if (!ParseScaled(text, precision, scaled)) {
+            Check(false, "badly formatted "s + where);
+            return;
+        }
+        Check(scaled == Expected(expected, precision), "wrongly rounded "s + where);
+    }
+
+    void TestPlainMatchesDocument() {
+        const Scene scene = MakeScene();
+        std::ostringstream expected;
+        scene.document.Render(expected);
+        for (const size_t threads : {1u, 3u}) {
+            std::ostringstream actual;
+            scene.flat.Render(actual, {}, threads);
+            Check(actual.str() == expected.str(), "plain output differs from svg::Document on "s
+                  + std::to_string(threads) + " threads"s);
+        }
+    }
+
+    void TestCompactRounding() {
+        const Scene scene = MakeScene();
+        const std::regex circle_pattern(R"re(<circle[^>]* cx="([^"]*)" cy="([^"]*)" r="([^"]*)")re");
+        const std::regex path_pattern(R"re(<path[^>]* d="([^"]*)")re");
+        const std::regex text_pattern(R"re(<text[^>]* x="([^"]*)" y="([^"]*)")re");
+        const std::regex path_number(R"((-?[0-9.]+))");
+
+        for (int precision = 0; precision <= 4; ++precision) {
+            std::ostringstream out;
+            scene.flat.Render(out, {true, precision});
+            const std::string svg = out.str();
+
+            std::ostringstream threaded;
+            scene.flat.Render(threaded, {true, precision}, 3);
+            Check(threaded.str() == svg, "compact output depends on the thread count");
+            Check(svg.find('\n') == std::string::npos, "compact output has no line breaks");
+            Check(svg.find("<polyline"sv) == std::string::npos, "compact output draws polylines as paths");
+
+            const auto circles = Matches(svg, circle_pattern);
+            Check(circles.size() == 3 * scene.circles.size(), "every circle is rendered");
+            for (size_t i = 0; i < scene.circles.size() && 3 * i + 2 < circles.size(); ++i) {
+                CheckNumber(circles[3 * i], scene.circles[i].x, precision, "circle cx"sv);
+                CheckNumber(circles[3 * i + 1], scene.circles[i].y, precision, "circle cy"sv);
+                CheckNumber(circles[3 * i + 2], scene.radii[i], precision, "circle r"sv);
+            }
+
+            const auto texts = Matches(svg, text_pattern);
+            Check(texts.size() == 2 * scene.texts.size(), "every text is rendered");
+            for (size_t i = 0; i < scene.texts.size() && 2 * i + 1 < texts.size(); ++i) {
+                CheckNumber(texts[2 * i], scene.texts[i].x, precision, "text x"sv);
+                CheckNumber(texts[2 * i + 1], scene.texts[i].y, precision, "text y"sv);
+            }
+
+            //Путь: M x y, затем l и смещения; вершина — сумма смещений, она должна быть округлённой исходной
+            const auto paths = Matches(svg, path_pattern);
+            Check(paths.size() == scene.polylines.size(), "every polyline is rendered");
+            for (size_t i = 0; i < scene.polylines.size() && i < paths.size(); ++i) {
+                const std::string& d = paths[i];
+                Check(d.size() > 1 && d[0] == 'M' && std::count(d.begin(), d.end(), 'l') == 1
+                      && std::count_if(d.begin(), d.end(), [](char c) { return std::isalpha(static_cast<unsigned char>(c)); }) == 2,
+                      "path has one absolute and one relative command: "s + d);
+                const auto numbers = Matches(d, path_number);
+                const auto& points = scene.polylines[i];
+                Check(numbers.size() == 2 * points.size(), "path has every vertex: "s + d);
+                int64_t x = 0;
+                int64_t y = 0;
+                for (size_t vertex = 0; vertex < points.size() && 2 * vertex + 1 < numbers.size(); ++vertex) {
+                    int64_t dx = 0;
+                    int64_t dy = 0;
+                    if (!ParseScaled(numbers[2 * vertex], precision, dx) || !ParseScaled(numbers[2 * vertex + 1], precision, dy)) {
+                        Check(false, "badly formatted path "s + d);
+                        break;
+                    }
+                    x += dx;
+                    y += dy;
+                    Check(x == Expected(points[vertex].x, precision) && y == Expected(points[vertex].y, precision),
+                          "path vertex "s + std::to_string(vertex) + " drifts at precision "s + std::to_string(precision));
+                }
+            }
+        }
+    }
+
+    constexpr std::string_view BASE = R"({
+  "base_requests": [
+    {"is_roundtrip": true, "name": "297", "stops": ["Biryulyovo Zapadnoye", "Biryulyovo Tovarnaya", "Universam", "Biryulyovo Zapadnoye"], "type": "Bus"},
+    {"is_roundtrip": false, "name": "635", "stops": ["Biryulyovo Tovarnaya", "Universam", "Prazhskaya"], "type": "Bus"},
+    {"latitude": 55.574371, "longitude": 37.6517, "name": "Biryulyovo Zapadnoye", "road_distances": {"Biryulyovo Tovarnaya": 2600}, "type": "Stop"},
+    {"latitude": 55.587655, "longitude": 37.645687, "name": "Universam", "road_distances": {"Biryulyovo Tovarnaya": 1380, "Biryulyovo Zapadnoye": 2500, "Prazhskaya": 4650}, "type": "Stop"},
+    {"latitude": 55.592028, "longitude": 37.653656, "name": "Biryulyovo Tovarnaya", "road_distances": {"Universam": 890}, "type": "Stop"},
+    {"latitude": 55.611717, "longitude": 37.603938, "name": "Prazhskaya", "road_distances": {}, "type": "Stop"}
+  ],
+  "render_settings": {
+    "bus_label_font_size": 20, "bus_label_offset": [7, 15], "color_palette": ["green", [255, 160, 0], "red"],
+    "height": 200, "line_width": 14, "padding": 30, "stop_label_font_size": 20, "stop_label_offset": [7, -3],
+    "stop_radius": 5, "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3, "width": 200,
+    "compact_svg": true, "svg_precision": 1
+  },
+  "routing_settings": {"bus_velocity": 30, "bus_wait_time": 2},
+  "stat_requests": [
+    {"id": 1, "type": "Map"}
+  ]
+})"sv;
+
+    void TestMapPrecision() {
+        TransportCatalogue catalogue;
+        json::Cursor cursor(BASE);
+        json_reader::JsonReader reader(cursor, catalogue);
+
+        const TransportRouter router(catalogue, reader.RouterSettingsReturn());
+        const request_handler::RequestHandler handler(catalogue, reader.RenderSettingsReturn(), router, 1);
+        std::vector<StatRequest> requests = reader.StatRequestsReturn();
+        std::ostringstream out;
+        {
+            json_reader::AnswerWriter writer(out, reader.RouterSettingsReturn());
+            for (auto& request : requests) {
+                catalogue.Resolve(request);
+                writer.Write(request.id, handler.ProcessRequest(request));
+            }
+            writer.Finish();
+        }
+        const std::string svg = json::Load(out.str()).GetRoot().AsArray().at(0).AsMap().at("map"s).AsString();
+
+        Check(svg.find("<path"sv) != std::string::npos, "map routes are paths");
+        const std::regex coordinate_attr(R"re( (?:cx|cy|r|x|y|d)="([^"]*)")re");
+        const std::regex number(R"((-?[0-9.]+))");
+        size_t count = 0;
+        for (const auto& value : Matches(svg, coordinate_attr)) {
+            for (const auto& text : Matches(value, number)) {
+                int64_t scaled = 0;
+                Check(ParseScaled(text, 1, scaled), "map number "s + text + " is not rounded to svg_precision"s);
+                ++count;
+            }
+        }
+        Check(count > 0, "map has coordinates");
+    }
+
+}//namespace
+
+int main() {
+    TestPlainMatchesDocument();
+    TestCompactRounding();
+    TestMapPrecision();
+    if (failures != 0) {
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
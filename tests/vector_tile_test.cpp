@@ -0,0 +1,450 @@
+// Векторные тайлы: закодированный тайл разбирается обратно независимым декодером protobuf.
+// Проверяются поля сообщений Tile, Layer, Feature и Value, таблицы ключей и значений, команды
+// MoveTo/LineTo с числом повторов и координаты после сложения смещений zig-zag.
+// Примеры геометрии из спецификации Mapbox Vector Tile 2.1 сверяются побайтно,
+// тайл (0, 0, 0) карты — с проекцией остановок SphereProjector
+
+#include "json.h"
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "map_tiles.h"
+#include "transport_catalogue.h"
+#include "vector_tile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vector_tile {
+    bool operator==(Point lhs, Point rhs) {
+        return lhs.x == rhs.x && lhs.y == rhs.y;
+    }
+}//namespace vector_tile
+
+namespace {
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+    using transport_catalogue::TransportCatalogue;
+
+    int failures = 0;
+
+    void Check(bool condition, std::string_view message) {
+        if (!condition) {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    //Разбор protobuf: только varint и поля с длиной, других типов в тайле быть не должно
+    class ProtoReader {
+    public:
+        explicit ProtoReader(std::string_view data)
+                : data_(data) {
+        }
+
+        bool AtEnd() const {
+            return pos_ >= data_.size() || !ok_;
+        }
+        bool Ok() const {
+            return ok_;
+        }
+
+        uint64_t Varint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (pos_ >= data_.size()) {
+                    break;
+                }
+                const auto byte = static_cast<uint8_t>(data_[pos_++]);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            ok_ = false;
+            return 0;
+        }
+
+        // Номер очередного поля; wire_type — его тип
+        uint32_t Key(uint32_t& wire_type) {
+            const uint64_t key = Varint();
+            wire_type = static_cast<uint32_t>(key & 0x7);
+            if (wire_type != 0 && wire_type != 2) {
+                ok_ = false;
+            }
+            return static_cast<uint32_t>(key >> 3);
+        }
+
+        std::string_view Bytes() {
+            const uint64_t size = Varint();
+            if (size > data_.size() - pos_) {
+                ok_ = false;
+                return {};
+            }
+            const std::string_view bytes = data_.substr(pos_, size);
+            pos_ += size;
+            return bytes;
+        }
+
+        std::vector<uint32_t> Packed() {
+            ProtoReader packed(Bytes());
+            std::vector<uint32_t> values;
+            while (!packed.AtEnd()) {
+                values.push_back(static_cast<uint32_t>(packed.Varint()));
+            }
+            ok_ = ok_ && packed.Ok();
+            return values;
+        }
+
+    private:
+        std::string_view data_;
+        size_t pos_ = 0;
+        bool ok_ = true;
+    };
+
+    using Value = vector_tile::Value;
+
+    struct Feature {
+        uint64_t id = 0;
+        uint32_t type = 0;
+        std::map<std::string, Value> tags;
+        std::vector<uint32_t> geometry;
+    };
+
+    struct Layer {
+        std::string name;
+        uint64_t extent = 0;
+        uint64_t version = 0;
+        std::vector<Feature> features;
+    };
+
+    Value DecodeValue(std::string_view data) {
+        ProtoReader reader(data);
+        Value value;
+        while (!reader.AtEnd()) {
+            uint32_t wire_type = 0;
+            const uint32_t field = reader.Key(wire_type);
+            if (field == 1 && wire_type == 2) {
+                value = std::string(reader.Bytes());
+            } else if (field == 5 && wire_type == 0) {
+                value = reader.Varint();
+            } else if (field == 7 && wire_type == 0) {
+                value = reader.Varint() != 0;
+            } else {
+                Check(false, "unexpected Value field "s + std::to_string(field));
+                break;
+            }
+        }
+        Check(reader.Ok(), "Value is well-formed");
+        return value;
+    }
+
+    Layer DecodeLayer(std::string_view data) {
+        ProtoReader reader(data);
+        Layer layer;
+        std::vector<std::pair<uint64_t, std::vector<uint32_t>>> raw_tags; // номер объекта и его теги
+        std::vector<std::string> keys;
+        std::vector<Value> values;
+        while (!reader.AtEnd()) {
+            uint32_t wire_type = 0;
+            const uint32_t field = reader.Key(wire_type);
+            if (field == 1 && wire_type == 2) {
+                layer.name = std::string(reader.Bytes());
+            } else if (field == 2 && wire_type == 2) {
+                ProtoReader feature_reader(reader.Bytes());
+                Feature& feature = layer.features.emplace_back();
+                std::vector<uint32_t> tags;
+                while (!feature_reader.AtEnd()) {
+                    uint32_t feature_wire_type = 0;
+                    const uint32_t feature_field = feature_reader.Key(feature_wire_type);
+                    if (feature_field == 1 && feature_wire_type == 0) {
+                        feature.id = feature_reader.Varint();
+                    } else if (feature_field == 2 && feature_wire_type == 2) {
+                        tags = feature_reader.Packed();
+                    } else if (feature_field == 3 && feature_wire_type == 0) {
+                        feature.type = static_cast<uint32_t>(feature_reader.Varint());
+                    } else if (feature_field == 4 && feature_wire_type == 2) {
+                        feature.geometry = feature_reader.Packed();
+                    } else {
+                        Check(false, "unexpected Feature field "s + std::to_string(feature_field));
+                        break;
+                    }
+                }
+                Check(feature_reader.Ok(), "Feature is well-formed");
+                raw_tags.emplace_back(layer.features.size() - 1, std::move(tags));
+            } else if (field == 3 && wire_type == 2) {
+                keys.emplace_back(reader.Bytes());
+            } else if (field == 4 && wire_type == 2) {
+                values.push_back(DecodeValue(reader.Bytes()));
+            } else if (field == 5 && wire_type == 0) {
+                layer.extent = reader.Varint();
+            } else if (field == 15 && wire_type == 0) {
+                layer.version = reader.Varint();
+            } else {
+                Check(false, "unexpected Layer field "s + std::to_string(field));
+                break;
+            }
+        }
+        Check(reader.Ok(), "Layer is well-formed");
+        Check(std::set<std::string>(keys.begin(), keys.end()).size() == keys.size(), "layer keys are unique");
+        for (const auto& [index, tags] : raw_tags) {
+            Check(tags.size() % 2 == 0, "tags are key/value pairs");
+            for (size_t i = 0; i + 1 < tags.size(); i += 2) {
+                if (tags[i] >= keys.size() || tags[i + 1] >= values.size()) {
+                    Check(false, "tag refers outside the key and value tables");
+                    continue;
+                }
+                layer.features[index].tags[keys[tags[i]]] = values[tags[i + 1]];
+            }
+        }
+        return layer;
+    }
+
+    std::vector<Layer> DecodeTile(std::string_view data) {
+        ProtoReader reader(data);
+        std::vector<Layer> layers;
+        while (!reader.AtEnd()) {
+            uint32_t wire_type = 0;
+            const uint32_t field = reader.Key(wire_type);
+            if (field == 3 && wire_type == 2) {
+                layers.push_back(DecodeLayer(reader.Bytes()));
+            } else {
+                Check(false, "unexpected Tile field "s + std::to_string(field));
+                break;
+            }
+        }
+        Check(reader.Ok(), "Tile is well-formed");
+        return layers;
+    }
+
+    int32_t UnZigZag(uint32_t value) {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    //Части геометрии: каждая начинается с MoveTo одной точки, LineTo продолжает текущую часть.
+    //Курсор не сбрасывается между частями
+    std::vector<std::vector<vector_tile::Point>> DecodeGeometry(const std::vector<uint32_t>& geometry) {
+        std::vector<std::vector<vector_tile::Point>> parts;
+        vector_tile::Point cursor;
+        size_t i = 0;
+        while (i < geometry.size()) {
+            const uint32_t command = geometry[i] & 0x7;
+            const uint32_t count = geometry[i] >> 3;
+            ++i;
+            if (command == 1) {
+                Check(count == 1, "MoveTo has one point");
+                parts.emplace_back();
+            } else if (command == 2) {
+                Check(count >= 1 && !parts.empty() && !parts.back().empty(), "LineTo follows MoveTo");
+            } else {
+                Check(false, "unexpected command "s + std::to_string(command));
+                return parts;
+            }
+            if (i + 2 * count > geometry.size() || parts.empty()) {
+                Check(false, "command parameters are complete");
+                return parts;
+            }
+            for (uint32_t point = 0; point < count; ++point) {
+                cursor.x += UnZigZag(geometry[i++]);
+                cursor.y += UnZigZag(geometry[i++]);
+                parts.back().push_back(cursor);
+            }
+        }
+        return parts;
+    }
+
+    using Lines = std::vector<std::vector<vector_tile::Point>>;
+
+    //Геометрия из раздела 4.3.5 спецификации MVT 2.1
+    void TestSpecificationExamples() {
+        vector_tile::Layer layer("example");
+        layer.AddPoint(1, {25, 17}, {});
+        layer.AddLines(2, {{{2, 2}, {2, 10}, {10, 10}}}, {});
+        layer.AddLines(3, {{{2, 2}, {2, 10}, {10, 10}}, {{1, 1}, {3, 5}}}, {});
+        layer.AddPoint(4, {-3, 5000}, {});
+
+        const std::vector<Layer> layers = DecodeTile(vector_tile::EncodeTile({layer}));
+        Check(layers.size() == 1, "one layer");
+        if (layers.size() != 1 || layers[0].features.size() != 4) {
+            Check(false, "four features");
+            return;
+        }
+        const Layer& decoded = layers[0];
+        Check(decoded.name == "example"s, "layer name");
+        Check(decoded.extent == vector_tile::EXTENT, "layer extent");
+        Check(decoded.version == 2, "layer version");
+
+        Check(decoded.features[0].type == 1 && decoded.features[0].geometry == std::vector<uint32_t>{9, 50, 34},
+              "point geometry matches the specification");
+        Check(decoded.features[1].type == 2
+              && decoded.features[1].geometry == std::vector<uint32_t>{9, 4, 4, 18, 0, 16, 16, 0},
+              "linestring geometry matches the specification");
+        Check(decoded.features[2].type == 2
+              && decoded.features[2].geometry == std::vector<uint32_t>{9, 4, 4, 18, 0, 16, 16, 0, 9, 17, 17, 10, 4, 8},
+              "multilinestring geometry matches the specification");
+        Check(DecodeGeometry(decoded.features[3].geometry) == Lines{{{-3, 5000}}},
+              "points in the buffer outside the extent are kept");
+        for (size_t i = 0; i < decoded.features.size(); ++i) {
+            Check(decoded.features[i].id == i + 1, "feature ids are kept");
+        }
+    }
+
+    void TestLinesAndTags() {
+        vector_tile::Layer layer("routes");
+        const Lines lines{
+            {{100, 100}, {100, 100}, {200, 50}, {200, 50}, {4000, 4095}},
+            {{7, 7}, {7, 7}},
+            {{-64, 3000}, {0, 3000}},
+            {{1, 2}},
+        };
+        layer.AddLines(1, lines, {{"name", "297"s}, {"palette", uint64_t{1}}, {"is_roundtrip", true}});
+        layer.AddLines(2, {{{5, 5}, {5, 5}}, {}}, {{"name", "none"s}});
+        layer.AddLines(3, {{{0, 0}, {4096, 4096}}}, {{"name", "635"s}, {"palette", uint64_t{1}}, {"is_roundtrip", false}});
+        Check(!layer.IsEmpty(), "layer with lines is not empty");
+
+        const std::vector<Layer> layers = DecodeTile(vector_tile::EncodeTile({layer, vector_tile::Layer("empty")}));
+        Check(layers.size() == 1, "empty layers are not encoded");
+        if (layers.size() != 1 || layers[0].features.size() != 2) {
+            Check(false, "lines without two distinct points are skipped");
+            return;
+        }
+        const Feature& first = layers[0].features[0];
+        Check(first.id == 1 && first.type == 2, "first route is a linestring");
+        Check(DecodeGeometry(first.geometry) == Lines{{{100, 100}, {200, 50}, {4000, 4095}}, {{-64, 3000}, {0, 3000}}},
+              "repeated points and short parts are dropped");
+        Check(first.tags == std::map<std::string, Value>{{"name", "297"s}, {"palette", uint64_t{1}}, {"is_roundtrip", true}},
+              "first route tags");
+
+        const Feature& second = layers[0].features[1];
+        Check(second.id == 3, "feature without parts is skipped");
+        Check(DecodeGeometry(second.geometry) == Lines{{{0, 0}, {4096, 4096}}}, "second route geometry");
+        Check(second.tags == std::map<std::string, Value>{{"name", "635"s}, {"palette", uint64_t{1}}, {"is_roundtrip", false}},
+              "second route tags share the key and value tables");
+
+        Check(vector_tile::EncodeTile({vector_tile::Layer("empty")}).empty(), "tile without features is empty");
+    }
+
+    constexpr std::string_view BASE = R"({
+  "base_requests": [
+    {"is_roundtrip": true, "name": "297", "stops": ["Biryulyovo Zapadnoye", "Biryulyovo Tovarnaya", "Universam", "Biryulyovo Zapadnoye"], "type": "Bus"},
+    {"is_roundtrip": false, "name": "635", "stops": ["Biryulyovo Tovarnaya", "Universam", "Prazhskaya"], "type": "Bus"},
+    {"latitude": 55.574371, "longitude": 37.6517, "name": "Biryulyovo Zapadnoye", "road_distances": {"Biryulyovo Tovarnaya": 2600}, "type": "Stop"},
+    {"latitude": 55.587655, "longitude": 37.645687, "name": "Universam", "road_distances": {"Biryulyovo Tovarnaya": 1380, "Biryulyovo Zapadnoye": 2500, "Prazhskaya": 4650}, "type": "Stop"},
+    {"latitude": 55.592028, "longitude": 37.653656, "name": "Biryulyovo Tovarnaya", "road_distances": {"Universam": 890}, "type": "Stop"},
+    {"latitude": 55.611717, "longitude": 37.603938, "name": "Prazhskaya", "road_distances": {}, "type": "Stop"},
+    {"latitude": 55.6, "longitude": 37.6, "name": "Lonely", "road_distances": {}, "type": "Stop"}
+  ],
+  "render_settings": {
+    "bus_label_font_size": 20, "bus_label_offset": [7, 15], "color_palette": ["green", [255, 160, 0], "red"],
+    "height": 200, "line_width": 14, "padding": 30, "stop_label_font_size": 20, "stop_label_offset": [7, -3],
+    "stop_radius": 5, "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3, "width": 300
+  },
+  "routing_settings": {"bus_velocity": 30, "bus_wait_time": 2},
+  "stat_requests": []
+})"sv;
+
+    const Layer* FindLayer(const std::vector<Layer>& layers, std::string_view name) {
+        for (const Layer& layer : layers) {
+            if (layer.name == name) {
+                return &layer;
+            }
+        }
+        return nullptr;
+    }
+
+    //Тайл (0, 0, 0) покрывает холст max(width, height) × max(width, height)
+    void TestMapTile() {
+        TransportCatalogue catalogue;
+        json::Cursor cursor(BASE);
+        json_reader::JsonReader reader(cursor, catalogue);
+        const RendererSettings& settings = reader.RenderSettingsReturn();
+        const auto buses = catalogue.GetActiveBuses();
+        const MapTiles tiles(settings, buses);
+
+        std::vector<geo::Coordinates> coordinates;
+        std::map<std::string_view, geo::Coordinates> stops;
+        for (const auto& [name, bus] : buses) {
+            for (const Stop* stop : bus->route) {
+                coordinates.push_back({stop->latitude, stop->longitude});
+                stops[stop->stop_name] = coordinates.back();
+            }
+        }
+        const SphereProjector projector(coordinates.begin(), coordinates.end(), settings.width, settings.height,
+                                        settings.padding);
+        const double scale = vector_tile::EXTENT / std::max(settings.width, settings.height);
+        auto expected_point = [&](std::string_view stop) {
+            const svg::Point point = projector(stops.at(stop));
+            return vector_tile::Point{static_cast<int32_t>(std::lround(point.x * scale)),
+                                      static_cast<int32_t>(std::lround(point.y * scale))};
+        };
+
+        const std::vector<Layer> layers = DecodeTile(tiles.EncodeVectorTile({0, 0, 0}));
+        const Layer* routes = FindLayer(layers, "routes"sv);
+        const Layer* labels = FindLayer(layers, "route_labels"sv);
+        const Layer* stop_layer = FindLayer(layers, "stops"sv);
+        if (!routes || !labels || !stop_layer) {
+            Check(false, "tile has routes, route_labels and stops layers");
+            return;
+        }
+
+        Check(stop_layer->features.size() == stops.size(), "every stop on a route is in the tile, the lonely one is not");
+        for (const Feature& feature : stop_layer->features) {
+            const auto name = std::get_if<std::string>(&feature.tags.at("name"s));
+            if (!name || !stops.count(*name)) {
+                Check(false, "stop feature has a known name");
+                continue;
+            }
+            Check(feature.type == 1, "stop is a point");
+            Check(DecodeGeometry(feature.geometry) == Lines{{expected_point(*name)}}, "stop " + *name + " position");
+        }
+
+        //Кольцевой маршрут — ломаная по своим остановкам, некольцевой — туда и обратно
+        const std::map<std::string, std::vector<std::string_view>> route_stops{
+            {"297"s, {"Biryulyovo Zapadnoye"sv, "Biryulyovo Tovarnaya"sv, "Universam"sv, "Biryulyovo Zapadnoye"sv}},
+            {"635"s, {"Biryulyovo Tovarnaya"sv, "Universam"sv, "Prazhskaya"sv, "Universam"sv, "Biryulyovo Tovarnaya"sv}},
+        };
+        Check(routes->features.size() == route_stops.size(), "every route is in the tile");
+        uint64_t palette = 0;
+        for (const Feature& feature : routes->features) {
+            const auto name = std::get_if<std::string>(&feature.tags.at("name"s));
+            if (!name || !route_stops.count(*name)) {
+                Check(false, "route feature has a known name");
+                continue;
+            }
+            std::vector<vector_tile::Point> expected;
+            for (const std::string_view stop : route_stops.at(*name)) {
+                expected.push_back(expected_point(stop));
+            }
+            Check(feature.type == 2, "route is a linestring");
+            Check(DecodeGeometry(feature.geometry) == Lines{expected}, "route " + *name + " geometry");
+            Check(feature.tags.at("palette"s) == Value{palette++}, "route " + *name + " palette index");
+            Check(feature.tags.at("is_roundtrip"s) == Value{*name == "297"s}, "route " + *name + " is_roundtrip");
+        }
+
+        //Подписи: у кольцевого маршрута одна, у некольцевого — на обеих конечных
+        Check(labels->features.size() == 3, "route labels at the final stops");
+        for (const Feature& feature : labels->features) {
+            Check(feature.type == 1, "route label is a point");
+        }
+
+        Check(tiles.EncodeVectorTile({1, 2, 0}).empty(), "tile outside the map is empty");
+    }
+
+}//namespace
+
+int main() {
+    TestSpecificationExamples();
+    TestLinesAndTags();
+    TestMapTile();
+    if (failures != 0) {
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "answer_writer.h"
+
+namespace json_reader {
+    using namespace std::string_view_literals;
+
+    namespace {
+        //Ключи каждого ответа печатаются в том же порядке, что и у std::map в json::Dict
+
+        void WriteBusRoute(json::Writer& writer, int id, const BusRoute& bus) {
+            writer.StartDict();
+            writer.Key("curvature"sv);
+            writer.Double(bus.curvature);
+            writer.Key("request_id"sv);
+            writer.Int(id);
+            writer.Key("route_length"sv);
+            writer.Double(bus.true_length);
+            writer.Key("stop_count"sv);
+            writer.Int(static_cast<int>(bus.stops));
+            writer.Key("unique_stop_count"sv);
+            writer.Int(static_cast<int>(bus.unique_stops));
+            writer.EndDict();
+        }
+
+        void WriteStopRoutes(json::Writer& writer, int id, const StopRoutes& stop) {
+            writer.StartDict();
+            writer.Key("buses"sv);
+            writer.StartArray();
+            for (const auto bus : *stop.routes) {
+                writer.String(bus);
+            }
+            writer.EndArray();
+            writer.Key("request_id"sv);
+            writer.Int(id);
+            writer.EndDict();
+        }
+
+        void WriteMap(json::Writer& writer, int id, const RenderedMap& map) {
+            writer.StartDict();
+            writer.Key("map"sv);
+            const auto parts = map.EscapedParts();
+            writer.EscapedString({parts[0], parts[1], parts[2]});
+            writer.Key("request_id"sv);
+            writer.Int(id);
+            writer.EndDict();
+        }
+
+        void WriteBusTripRoute(json::Writer& writer, const RouterSettings& router_settings, int id, const BusTripRoute& route) {
+            writer.StartDict();
+            writer.Key("items"sv);
+            writer.StartArray();
+            for (const auto& stage : route.stages_) {
+                writer.StartDict();
+                writer.Key("stop_name"sv);
+                writer.String(stage.stops_.first);
+                writer.Key("time"sv);
+                writer.Int(router_settings.bus_wait_time_);
+                writer.Key("type"sv);
+                writer.String("Wait"sv);
+                writer.EndDict();
+
+                writer.StartDict();
+                writer.Key("bus"sv);
+                writer.String(stage.bus_name_);
+                writer.Key("span_count"sv);
+                writer.Int(static_cast<int>(stage.span_count_));
+                writer.Key("time"sv);
+                writer.Double(stage.time_ - router_settings.bus_wait_time_);
+                writer.Key("type"sv);
+                writer.String("Bus"sv);
+                writer.EndDict();
+            }
+            writer.EndArray();
+            writer.Key("request_id"sv);
+            writer.Int(id);
+            writer.Key("total_time"sv);
+            writer.Double(route.total_time_);
+            writer.EndDict();
+        }
+
+        void WriteNotFound(json::Writer& writer, int id) {
+            writer.StartDict();
+            writer.Key("error_message"sv);
+            writer.String("not found"sv);
+            writer.Key("request_id"sv);
+            writer.Int(id);
+            writer.EndDict();
+        }
+    }//namespace
+
+    void WriteAnswer(json::Writer& writer, const RouterSettings& router_settings, int id, const Answer& answer) {
+        if (const auto* bus = std::get_if<BusRoute>(&answer)) {
+            bus->is_found ? WriteBusRoute(writer, id, *bus) : WriteNotFound(writer, id);
+        }
+        else if (const auto* stop = std::get_if<StopRoutes>(&answer)) {
+            stop->is_found ? WriteStopRoutes(writer, id, *stop) : WriteNotFound(writer, id);
+        }
+        else if (const auto* map = std::get_if<RenderedMap>(&answer)) {
+            map->escaped_svg ? WriteMap(writer, id, *map) : WriteNotFound(writer, id);
+        }
+        else if (const auto* route = std::get_if<BusTripRoute>(&answer)) {
+            route->is_found ? WriteBusTripRoute(writer, router_settings, id, *route) : WriteNotFound(writer, id);
+        }
+    }
+
+    AnswerWriter::AnswerWriter(std::ostream& output, const RouterSettings& router_settings)
+            : output_(output)
+            , router_settings_(router_settings)
+            , writer_(output) {
+        writer_.StartArray();
+    }
+
+    void AnswerWriter::Write(int id, const Answer& answer) {
+        WriteAnswer(writer_, router_settings_, id, answer);
+    }
+
+    void AnswerWriter::Finish() {
+        writer_.EndArray();
+        Flush();
+    }
+
+    void AnswerWriter::Flush() {
+        writer_.Flush();
+        output_.flush();
+    }
+
+}//namespace json_reader
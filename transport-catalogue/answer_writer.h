@@ -0,0 +1,38 @@
+#pragma once
+
+#include "domain.h"
+#include "json.h"
+#include "transport_router.h"
+
+#include <iostream>
+#include <variant>
+
+namespace json_reader {
+
+    using Answer = std::variant<BusRoute, StopRoutes, RenderedMap, BusTripRoute>;
+
+    // Печатает один ответ в writer; отступы задаёт формат writer. Ключи словарей идут
+    // в алфавитном порядке, как в json::Dict
+    void WriteAnswer(json::Writer& writer, const RouterSettings& router_settings, int id, const Answer& answer);
+
+    // Печатает ответы на stat_requests сразу в выходной поток, минуя построение json::Document.
+    // Вывод побайтно совпадает с json::Print дерева тех же ответов: ключи словарей идут
+    // в алфавитном порядке, как в json::Dict
+    class AnswerWriter {
+    public:
+        AnswerWriter(std::ostream& output, const RouterSettings& router_settings);
+
+        // Печатает очередной элемент массива ответов
+        void Write(int id, const Answer& answer);
+        // Закрывает массив ответов и сбрасывает буфер
+        void Finish();
+        // Сбрасывает накопленное в поток
+        void Flush();
+
+    private:
+        std::ostream& output_;
+        const RouterSettings& router_settings_;
+        json::Writer writer_;
+    };
+
+}//namespace json_reader
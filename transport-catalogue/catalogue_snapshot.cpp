@@ -0,0 +1,308 @@
+#include "catalogue_snapshot.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace transport_catalogue::snapshot {
+    namespace {
+        constexpr char MAGIC[8] = {'T', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+        constexpr size_t HEADER_SIZE = 64;
+        constexpr size_t STOP_RECORD_SIZE = 24;
+        constexpr size_t BUS_RECORD_SIZE = 20;
+        constexpr size_t ROUTE_ITEM_SIZE = 4;
+        constexpr size_t DISTANCE_RECORD_SIZE = 12;
+        constexpr uint32_t CIRCLE_FLAG = 1;
+
+        size_t Align(size_t offset) {
+            return (offset + 7) & ~size_t{7};
+        }
+
+        //Смещения секций однозначно вычисляются по размерам, поэтому в файле не хранятся
+        struct Layout {
+            size_t strings = HEADER_SIZE;
+            size_t stops = 0;
+            size_t buses = 0;
+            size_t routes = 0;
+            size_t distances = 0;
+            size_t total = 0;
+        };
+
+        Layout ComputeLayout(uint64_t strings_size, uint64_t stop_count, uint64_t bus_count,
+                             uint64_t route_item_count, uint64_t distance_count) {
+            Layout layout;
+            layout.stops = Align(layout.strings + strings_size);
+            layout.buses = Align(layout.stops + stop_count * STOP_RECORD_SIZE);
+            layout.routes = Align(layout.buses + bus_count * BUS_RECORD_SIZE);
+            layout.distances = Align(layout.routes + route_item_count * ROUTE_ITEM_SIZE);
+            layout.total = layout.distances + distance_count * DISTANCE_RECORD_SIZE;
+            return layout;
+        }
+
+        //-------------Запись и чтение little-endian----------------
+
+        void PutU32(std::string& out, size_t offset, uint32_t value) {
+            for (int i = 0; i < 4; ++i) {
+                out[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        void PutU64(std::string& out, size_t offset, uint64_t value) {
+            for (int i = 0; i < 8; ++i) {
+                out[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        void PutDouble(std::string& out, size_t offset, double value) {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            PutU64(out, offset, bits);
+        }
+
+        uint32_t GetU32(const char* data) {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+            uint32_t value = 0;
+            for (int i = 3; i >= 0; --i) {
+                value = (value << 8) | bytes[i];
+            }
+            return value;
+        }
+
+        uint64_t GetU64(const char* data) {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+            uint64_t value = 0;
+            for (int i = 7; i >= 0; --i) {
+                value = (value << 8) | bytes[i];
+            }
+            return value;
+        }
+
+        double GetDouble(const char* data) {
+            uint64_t bits = GetU64(data);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        uint32_t CheckedU32(size_t value) {
+            if (value > UINT32_MAX) {
+                throw SnapshotError("Catalogue is too large for snapshot format");
+            }
+            return static_cast<uint32_t>(value);
+        }
+    }//namespace
+
+    uint64_t ComputeSourceHash(std::string_view data) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char ch : data) {
+            hash ^= ch;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    void Save(const TransportCatalogue& catalogue, uint64_t source_hash, const std::string& path) {
+        //Записи идут в порядке добавления, номер остановки в файле — её Stop::id.
+        //LoadInto добавляет их в том же порядке, поэтому загруженный справочник совпадает с исходным
+        const auto& stops = catalogue.GetStopsById();
+        const auto& buses = catalogue.GetBusesInOrder();
+
+        //Собираем таблицу строк
+        std::string strings;
+        size_t route_item_count = 0;
+        size_t distance_count = 0;
+        for (const Stop* stop : stops) {
+            strings += stop->stop_name;
+            distance_count += stop->dist_to_next.size();
+        }
+        for (const Bus* bus : buses) {
+            strings += bus->bus_name;
+            route_item_count += bus->route.size();
+        }
+
+        const Layout layout = ComputeLayout(strings.size(), stops.size(), buses.size(),
+                                            route_item_count, distance_count);
+        std::string out(layout.total, '\0');
+        std::memcpy(out.data(), MAGIC, sizeof(MAGIC));
+        PutU32(out, 8, VERSION);
+        PutU32(out, 12, HEADER_SIZE);
+        PutU64(out, 16, source_hash);
+        PutU64(out, 24, layout.total);
+        PutU32(out, 32, CheckedU32(strings.size()));
+        PutU32(out, 36, CheckedU32(stops.size()));
+        PutU32(out, 40, CheckedU32(buses.size()));
+        PutU32(out, 44, CheckedU32(route_item_count));
+        PutU32(out, 48, CheckedU32(distance_count));
+        std::memcpy(out.data() + layout.strings, strings.data(), strings.size());
+
+        uint32_t name_offset = 0;
+        size_t stop_record = layout.stops;
+        size_t distance_record = layout.distances;
+        for (const Stop* stop : stops) {
+            PutU32(out, stop_record, name_offset);
+            PutU32(out, stop_record + 4, static_cast<uint32_t>(stop->stop_name.size()));
+            PutDouble(out, stop_record + 8, stop->latitude);
+            PutDouble(out, stop_record + 16, stop->longitude);
+            name_offset += stop->stop_name.size();
+            stop_record += STOP_RECORD_SIZE;
+            for (const auto& [to, distance] : stop->dist_to_next) {
+                PutU32(out, distance_record, static_cast<uint32_t>(stop->id));
+                PutU32(out, distance_record + 4, static_cast<uint32_t>(catalogue.GetStop(to)->id));
+                PutU32(out, distance_record + 8, distance);
+                distance_record += DISTANCE_RECORD_SIZE;
+            }
+        }
+
+        size_t bus_record = layout.buses;
+        uint32_t route_begin = 0;
+        for (const Bus* bus : buses) {
+            PutU32(out, bus_record, name_offset);
+            PutU32(out, bus_record + 4, static_cast<uint32_t>(bus->bus_name.size()));
+            PutU32(out, bus_record + 8, route_begin);
+            PutU32(out, bus_record + 12, static_cast<uint32_t>(bus->route.size()));
+            PutU32(out, bus_record + 16, bus->is_circle ? CIRCLE_FLAG : 0);
+            name_offset += bus->bus_name.size();
+            bus_record += BUS_RECORD_SIZE;
+            for (const Stop* stop : bus->route) {
+                PutU32(out, layout.routes + ROUTE_ITEM_SIZE * route_begin, static_cast<uint32_t>(stop->id));
+                ++route_begin;
+            }
+        }
+
+        //У каждого процесса свой временный файл рядом с целевым: одновременные обновления
+        //одного снимка не портят друг другу данные, а rename остаётся в пределах одной файловой системы
+        std::string tmp_path = path + ".XXXXXX";
+        const int fd = ::mkstemp(tmp_path.data());
+        if (fd < 0) {
+            throw SnapshotError("Can't create temporary file for snapshot " + path + ": " + std::strerror(errno));
+        }
+        bool written = ::fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == 0;
+        for (size_t offset = 0; written && offset < out.size();) {
+            const ssize_t result = ::write(fd, out.data() + offset, out.size() - offset);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            written = result > 0;
+            offset += written ? static_cast<size_t>(result) : 0;
+        }
+        written = ::close(fd) == 0 && written;
+        if (!written) {
+            std::remove(tmp_path.c_str());
+            throw SnapshotError("Can't write snapshot " + tmp_path);
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            throw SnapshotError("Can't replace snapshot " + path);
+        }
+    }
+
+    //-----------------Методы класса MappedSnapshot-----------------------
+
+    MappedSnapshot::MappedSnapshot(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw SnapshotError("Can't open snapshot " + path + ": " + std::strerror(errno));
+        }
+        struct stat file_stat{};
+        if (::fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < HEADER_SIZE) {
+            ::close(fd);
+            throw SnapshotError("Snapshot " + path + " is truncated");
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            throw SnapshotError("Can't map snapshot " + path + ": " + std::strerror(errno));
+        }
+        data_ = static_cast<const char*>(mapped);
+
+        try {
+            if (std::memcmp(data_, MAGIC, sizeof(MAGIC)) != 0) {
+                throw SnapshotError("Not a catalogue snapshot: " + path);
+            }
+            if (GetU32(data_ + 8) != VERSION || GetU32(data_ + 12) != HEADER_SIZE) {
+                throw SnapshotError("Unsupported snapshot version: " + path);
+            }
+            source_hash_ = GetU64(data_ + 16);
+            strings_size_ = GetU32(data_ + 32);
+            stop_count_ = GetU32(data_ + 36);
+            bus_count_ = GetU32(data_ + 40);
+            route_item_count_ = GetU32(data_ + 44);
+            distance_count_ = GetU32(data_ + 48);
+
+            const Layout layout = ComputeLayout(strings_size_, stop_count_, bus_count_,
+                                                route_item_count_, distance_count_);
+            if (GetU64(data_ + 24) != layout.total || size_ != layout.total) {
+                throw SnapshotError("Snapshot " + path + " is truncated");
+            }
+            strings_offset_ = layout.strings;
+            stops_offset_ = layout.stops;
+            buses_offset_ = layout.buses;
+            routes_offset_ = layout.routes;
+            distances_offset_ = layout.distances;
+        } catch (...) {
+            ::munmap(const_cast<char*>(data_), size_);
+            throw;
+        }
+    }
+
+    MappedSnapshot::~MappedSnapshot() {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    uint64_t MappedSnapshot::GetSourceHash() const {
+        return source_hash_;
+    }
+
+    std::string_view MappedSnapshot::ReadName(const char* record) const {
+        const size_t offset = GetU32(record);
+        const size_t size = GetU32(record + 4);
+        if (offset + size > strings_size_) {
+            throw SnapshotError("Snapshot name is out of string table");
+        }
+        return {data_ + strings_offset_ + offset, size};
+    }
+
+    void MappedSnapshot::LoadInto(TransportCatalogue& catalogue) const {
+        std::vector<std::string_view> stop_names;
+        stop_names.reserve(stop_count_);
+        for (uint32_t i = 0; i < stop_count_; ++i) {
+            const char* record = data_ + stops_offset_ + i * STOP_RECORD_SIZE;
+            stop_names.push_back(ReadName(record));
+            catalogue.AddStop(stop_names.back(), {GetDouble(record + 8), GetDouble(record + 16)});
+        }
+        //Номер остановки из файла проверяется так же, как смещения имён: испорченный снимок перестраивается
+        const auto stop_name = [&stop_names](const char* index) {
+            const uint32_t stop = GetU32(index);
+            if (stop >= stop_names.size()) {
+                throw SnapshotError("Snapshot stop index is out of range");
+            }
+            return stop_names[stop];
+        };
+        for (uint32_t i = 0; i < distance_count_; ++i) {
+            const char* record = data_ + distances_offset_ + i * DISTANCE_RECORD_SIZE;
+            catalogue.SetDistance(stop_name(record), stop_name(record + 4), GetU32(record + 8));
+        }
+        std::vector<std::string_view> route;
+        for (uint32_t i = 0; i < bus_count_; ++i) {
+            const char* record = data_ + buses_offset_ + i * BUS_RECORD_SIZE;
+            const uint32_t route_begin = GetU32(record + 8);
+            const uint32_t route_size = GetU32(record + 12);
+            if (static_cast<uint64_t>(route_begin) + route_size > route_item_count_) {
+                throw SnapshotError("Snapshot route is out of range");
+            }
+            route.clear();
+            for (uint32_t j = 0; j < route_size; ++j) {
+                route.push_back(stop_name(data_ + routes_offset_ + (route_begin + j) * ROUTE_ITEM_SIZE));
+            }
+            catalogue.AddBus(ReadName(record), route, (GetU32(record + 16) & CIRCLE_FLAG) != 0);
+        }
+    }
+
+}//namespace transport_catalogue::snapshot
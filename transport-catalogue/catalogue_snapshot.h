@@ -0,0 +1,76 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace transport_catalogue::snapshot {
+
+    // Бинарный снимок справочника.
+    // Все числа записаны в little-endian, ссылки между секциями — смещения и индексы, без указателей,
+    // поэтому файл можно отображать в память (mmap) и разделять между процессами.
+    //
+    // Заголовок (64 байта):
+    //   magic "TCSNAP\0\0", version, header_size, source_hash, file_size,
+    //   strings_size, stop_count, bus_count, route_item_count, distance_count
+    // Секции (каждая выровнена на 8 байт):
+    //   strings   — имена остановок и маршрутов подряд
+    //   stops     — {name_offset, name_size, latitude, longitude} в порядке Stop::id
+    //   buses     — {name_offset, name_size, route_begin, route_size, flags} в порядке добавления
+    //   routes    — индексы остановок маршрутов (Stop::id)
+    //   distances — {from, to, meters}
+
+    inline constexpr uint32_t VERSION = 1;
+
+    class SnapshotError : public std::runtime_error {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+    // Хеш исходного JSON (FNV-1a, 64 бита), по которому проверяется актуальность снимка
+    uint64_t ComputeSourceHash(std::string_view data);
+
+    // Записывает снимок справочника. Файл заменяется атомарно через уникальный временный файл в том же каталоге
+    void Save(const TransportCatalogue& catalogue, uint64_t source_hash, const std::string& path);
+
+    // Снимок, отображённый в память только для чтения
+    class MappedSnapshot {
+    public:
+        // Бросает SnapshotError, если файл отсутствует, повреждён или другой версии
+        explicit MappedSnapshot(const std::string& path);
+        ~MappedSnapshot();
+
+        MappedSnapshot(const MappedSnapshot&) = delete;
+        MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+        uint64_t GetSourceHash() const;
+
+        // Заполняет справочник данными снимка. Остановки и маршруты добавляются в порядке записей,
+        // то есть в порядке исходной базы, и получают те же Stop::id. Отображение избавляет от разбора JSON,
+        // но таблицы справочника строятся заново: данные копируются из файла, а не читаются через него
+        void LoadInto(TransportCatalogue& catalogue) const;
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+
+        uint64_t source_hash_ = 0;
+        uint32_t stop_count_ = 0;
+        uint32_t bus_count_ = 0;
+        uint32_t route_item_count_ = 0;
+        uint32_t distance_count_ = 0;
+
+        size_t strings_offset_ = 0;
+        size_t strings_size_ = 0;
+        size_t stops_offset_ = 0;
+        size_t buses_offset_ = 0;
+        size_t routes_offset_ = 0;
+        size_t distances_offset_ = 0;
+
+        std::string_view ReadName(const char* record) const;
+    };
+
+}//namespace transport_catalogue::snapshot
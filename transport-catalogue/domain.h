@@ -1,11 +1,15 @@
 #pragma once
+#include <array>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <set>
+#include <variant>
 
 struct Stop {
+    size_t id = 0; // порядковый номер остановки в справочнике
     std::string_view stop_name;
     double latitude = 0.0;
     double longitude = 0.0;
@@ -23,7 +27,7 @@ struct Bus {
 };
 
 struct BusRoute {
-    std::string bus_name;
+    std::string_view bus_name;
     size_t stops = 0;
     size_t unique_stops = 0;
     double true_length = 0.0;
@@ -31,8 +35,71 @@ struct BusRoute {
     bool is_found = false;
 };
 
+// Отрисованная карта — готовый SVG-текст, сразу экранированный для строки JSON.
+// Все ответы на Map ссылаются на один общий буфер. Без текста — карта не построена
+// (для RouteMap: маршрут не найден)
+struct RenderedMap {
+    std::shared_ptr<const std::string> escaped_svg;
+    // Слой поверх карты (запрос RouteMap), экранированный так же. Выводится перед закрывающим тегом
+    // escaped_svg, поэтому общая карта из кэша не копируется в каждый ответ
+    std::string escaped_overlay;
+
+    // Экранированный текст карты по частям: без слоя — карта целиком, со слоем — начало карты, слой и закрывающий тег.
+    // Экранирование не затрагивает закрывающий тег, поэтому его можно отрезать от готового текста
+    std::array<std::string_view, 3> EscapedParts() const {
+        static constexpr std::string_view CLOSING_TAG = "</svg>";
+        const std::string_view svg = *escaped_svg;
+        if (escaped_overlay.empty()) {
+            return {svg, {}, {}};
+        }
+        return {svg.substr(0, svg.size() - CLOSING_TAG.size()), escaped_overlay, CLOSING_TAG};
+    }
+};
+
 struct StopRoutes {
-    std::string stop_name;
-    std::set<std::string_view> routes;
+    std::string_view stop_name;
+    const std::set<std::string_view>* routes = nullptr; // принадлежит справочнику
     bool is_found = false;
+};
+
+// Типизированные запросы к справочнику (stat_requests).
+// Названия разрешаются в указатели на объекты справочника один раз при разборе,
+// nullptr после разрешения означает, что объект не найден
+
+struct BusQuery {
+    std::string name;
+    const Bus* bus = nullptr;
+};
+
+struct StopQuery {
+    std::string name;
+    const Stop* stop = nullptr;
+};
+
+struct RouteQuery {
+    std::string from;
+    std::string to;
+    const Stop* from_stop = nullptr;
+    const Stop* to_stop = nullptr;
+};
+
+struct MapQuery {
+};
+
+// Карта с выделенным поверх неё маршрутом между двумя остановками
+struct RouteMapQuery {
+    RouteQuery route;
+};
+
+// Тайл карты: на уровне z карта делится на 2^z × 2^z квадратов, x — столбец, y — строка
+struct TileQuery {
+    int z = 0;
+    int x = 0;
+    int y = 0;
+};
+
+struct StatRequest {
+    int id = 0;
+    std::variant<BusQuery, StopQuery, RouteQuery, MapQuery, TileQuery, RouteMapQuery> query;
+    bool is_resolved = false;
 };
\ No newline at end of file
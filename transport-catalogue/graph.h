@@ -1,5 +1,6 @@
 #pragma once
 
+#include "memory_usage.h"
 #include "ranges.h"
 
 #include <cstdlib>
@@ -32,6 +33,7 @@ public:
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const; //Выдать ребра, принадлежащие вершине
+    memory::Usage MemoryUsage() const; //Динамическая память рёбер и списков смежности
 
 private:
     std::vector<Edge<Weight>> edges_;
@@ -71,4 +73,13 @@ typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
+
+template <typename Weight>
+memory::Usage DirectedWeightedGraph<Weight>::MemoryUsage() const {
+    memory::Usage usage = memory::Heap(edges_) + memory::Heap(incidence_lists_);
+    for (const auto& incidence_list : incidence_lists_) {
+        usage += memory::Heap(incidence_list);
+    }
+    return usage;
+}
 }  // namespace graph
\ No newline at end of file
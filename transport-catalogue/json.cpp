@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <istream>
 
 #include "json.h"
+#include "json_scan.h"
 
 using namespace std;
 
@@ -8,177 +12,189 @@ namespace json {
 
     namespace {
 
-        //-------------Загрузка данных----------------
+        //-------------Разбор непрерывного буфера----------------
 
-        Node LoadNode(istream& input);
-        Node LoadArray(istream& input) {
-            Array result;
+        // Разбирает документ, целиком лежащий в памяти. Пробелы и содержимое строк пропускаются
+        // блоками по 16 байт (SSE2), числа преобразуются std::from_chars без промежуточных строк.
+        // Ошибки содержат смещение от начала буфера
+        class BufferParser {
+        public:
+            explicit BufferParser(std::string_view text)
+                    : begin_(text.data())
+                    , pos_(text.data())
+                    , end_(text.data() + text.size()) {
+            }
 
-            for (char c; input >> c && c != ']';) {
-                if (c != ',') {
-                    input.putback(c);
-                }
-                result.push_back(LoadNode(input));
-            }
-            if (!input) {
-                throw ParsingError("Need ']' symbol to close array");
-            }
-
-            return Node(move(result));
-        }
-        Node LoadString(std::istream& input) {
-            char ch;
-            std::string str;
-            bool is_escape = false;
-            while (input.get(ch)) {
-                if (is_escape) {
-                    switch (ch) {
-                        case 'n': str += '\n'; break;
-                        case 'r': str += '\r'; break;
-                        case 't': str += '\t'; break;
-                        case '"': [[fallthrough]];
-                        case '\\': str += ch; break;
-                        default: throw ParsingError("Invalid escape sequence");
-                    }
-                    is_escape = false;
-                }
-                else if (ch == '\\') {
-                    is_escape = true;
-                    continue;
-                }
-                else if (ch == '"') {
-                    break;
-                }
-                else {
-                    str += ch;
-                }
+            //Разбор с позиции pos внутри документа [begin, end), смещения в ошибках — от begin.
+            //depth — вложенность pos в документе, она учитывается в ограничении detail::MAX_DEPTH
+            BufferParser(const char* begin, const char* pos, const char* end, size_t depth)
+                    : begin_(begin)
+                    , pos_(pos)
+                    , end_(end)
+                    , depth_(depth) {
             }
-            if (!input) {
-                throw ParsingError("No '\"' symbol in the end of the string");
+
+            //Разбирает одно значение и останавливается сразу после него
+            Node ParseValue() {
+                return ParseNode();
             }
-            return Node(move(str));
-        }
-        Node LoadDict(istream& input) {
-            Dict result;
-            for (char c; input >> c && c != '}';) {
-                if (c == ',') {
-                    input >> c;
-                }
-                string key = LoadString(input).AsString();
-                input >> c;
-                result.insert({move(key), LoadNode(input)});
+
+            const char* Position() const {
+                return pos_;
             }
-            if (!input) {
-                throw ParsingError("Need '}' symbol to close dictionary");
+
+            Node ParseDocument() {
+                Node root = ParseNode();
+                SkipSpaces();
+                if (pos_ != end_) {
+                    Fail("Unexpected symbols after the document"s);
+                }
+                return root;
             }
-            return Node(move(result));
-        }
-        Node LoadBool(std::istream& input) {
-            if (bool value; input >> std::boolalpha >> value) {
-                return Node(value);
+
+        private:
+            const char* begin_;
+            const char* pos_;
+            const char* end_;
+            size_t depth_ = 0;
+
+            [[noreturn]] void Fail(const std::string& message) const {
+                throw ParsingError(message, static_cast<size_t>(pos_ - begin_));
             }
 
-            throw ParsingError("Fail to read bool from stream"s);
-        }
-        Node LoadNull(istream& input) {
-            if (input.get() == 'n' && input.get() == 'u' && input.get() == 'l' && input.get() == 'l') {
-                return Node(nullptr);
+            void SkipSpaces() {
+                pos_ = detail::SkipSpaces(pos_, end_);
             }
-            else throw json::ParsingError("Fail to read null from stream"s);
-        }
-        Node LoadNumber(std::istream& input) {
-            using namespace std::literals;
 
-            std::string parsed_num;
+            char Next() {
+                SkipSpaces();
+                if (pos_ == end_) {
+                    Fail("Unexpected end of the document"s);
+                }
+                return *pos_;
+            }
 
-            // Считывает в parsed_num очередной символ из input
-            auto read_char = [&parsed_num, &input] {
-                parsed_num += static_cast<char>(input.get());
-                if (!input) {
-                    throw ParsingError("Failed to read number from stream"s);
+            Node ParseNode() {
+                switch (Next()) {
+                    case '[': return ParseArray();
+                    case '{': return ParseDict();
+                    case '"': return Node(ParseString());
+                    case 't': return ParseLiteral("true"sv, Node(true));
+                    case 'f': return ParseLiteral("false"sv, Node(false));
+                    case 'n': return ParseLiteral("null"sv, Node(nullptr));
+                    default: return ParseNumber();
                 }
-            };
+            }
 
-            // Считывает одну или более цифр в parsed_num из input
-            auto read_digits = [&input, read_char] {
-                if (!std::isdigit(input.peek())) {
-                    throw ParsingError("A digit is expected"s);
+            Node ParseArray() {
+                const detail::DepthGuard guard(depth_, begin_, pos_);
+                ++pos_;
+                Array result;
+                if (Next() == ']') {
+                    ++pos_;
+                    return Node(move(result));
                 }
-                while (std::isdigit(input.peek())) {
-                    read_char();
+                while (true) {
+                    result.push_back(ParseNode());
+                    const char c = Next();
+                    ++pos_;
+                    if (c == ']') {
+                        return Node(move(result));
+                    }
+                    if (c != ',') {
+                        --pos_;
+                        Fail("Need ',' or ']' in array"s);
+                    }
                 }
-            };
-
-            if (input.peek() == '-') {
-                read_char();
             }
-            // Парсим целую часть числа
-            if (input.peek() == '0') {
-                read_char();
-                // После 0 в JSON не могут идти другие цифры
-            } else {
-                read_digits();
+
+            Node ParseDict() {
+                const detail::DepthGuard guard(depth_, begin_, pos_);
+                ++pos_;
+                Dict result;
+                if (Next() == '}') {
+                    ++pos_;
+                    return Node(move(result));
+                }
+                while (true) {
+                    if (Next() != '"') {
+                        Fail("Dictionary key is expected"s);
+                    }
+                    string key = ParseString();
+                    if (Next() != ':') {
+                        Fail("Need ':' after dictionary key"s);
+                    }
+                    ++pos_;
+                    //Ключи во входных данных обычно упорядочены, подсказка делает вставку дешёвой
+                    result.emplace_hint(result.end(), move(key), ParseNode());
+                    const char c = Next();
+                    ++pos_;
+                    if (c == '}') {
+                        return Node(move(result));
+                    }
+                    if (c != ',') {
+                        --pos_;
+                        Fail("Need ',' or '}' in dictionary"s);
+                    }
+                }
             }
 
-            bool is_int = true;
-            // Парсим дробную часть числа
-            if (input.peek() == '.') {
-                read_char();
-                read_digits();
-                is_int = false;
+            string ParseString() {
+                ++pos_;
+                string str;
+                while (true) {
+                    const char* special = detail::FindStringSpecial(pos_, end_);
+                    str.append(pos_, special);
+                    pos_ = special;
+                    if (pos_ == end_) {
+                        Fail("No '\"' symbol in the end of the string"s);
+                    }
+                    if (*pos_ == '"') {
+                        ++pos_;
+                        return str;
+                    }
+                    if (++pos_ == end_) {
+                        Fail("No '\"' symbol in the end of the string"s);
+                    }
+                    char unescaped;
+                    if (!detail::Unescape(*pos_, unescaped)) {
+                        Fail("Invalid escape sequence"s);
+                    }
+                    str += unescaped;
+                    ++pos_;
+                }
             }
 
-            // Парсим экспоненциальную часть числа
-            if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-                read_char();
-                if (ch = input.peek(); ch == '+' || ch == '-') {
-                    read_char();
+            Node ParseLiteral(std::string_view literal, Node value) {
+                if (static_cast<size_t>(end_ - pos_) < literal.size()
+                    || std::string_view(pos_, literal.size()) != literal) {
+                    Fail("Unknown literal"s);
                 }
-                read_digits();
-                is_int = false;
+                pos_ += literal.size();
+                return value;
             }
 
-            try {
+            Node ParseNumber() {
+                //Сначала проверяется грамматика JSON, затем число преобразуется целиком
+                bool is_int;
+                const char* it = detail::ScanNumber(begin_, pos_, end_, is_int);
                 if (is_int) {
-                    // Сначала пробуем преобразовать строку в int
-                    try {
-                        return std::stoi(parsed_num);
-                    } catch (...) {
-                        // В случае неудачи, например, при переполнении,
-                        // код ниже попробует преобразовать строку в double
+                    int value;
+                    if (const auto result = std::from_chars(pos_, it, value); result.ec == std::errc{}) {
+                        pos_ = it;
+                        return Node(value);
                     }
+                    //При переполнении int число читается как double
                 }
-                return std::stod(parsed_num);
-            } catch (...) {
-                throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
-            }
-        }
-        Node LoadNode(istream& input) {
-            char c;
-            input >> c;
-
-            if (c == '[') {
-                return LoadArray(input);
-            }
-            else if (c == '{') {
-                return LoadDict(input);
-            }
-            else if (c == '"') {
-                return LoadString(input);
-            }
-            else if(c == 'f' || c == 't'){
-                input.putback(c);
-                return LoadBool(input);
-            }
-            else if( c == 'n'){
-                input.putback(c);
-                return LoadNull(input);
-            }
-            else {
-                input.putback(c);
-                return LoadNumber(input);
+                double value;
+                if (const auto result = std::from_chars(pos_, it, value);
+                        result.ec != std::errc{} || result.ptr != it) {
+                    Fail("Failed to convert "s + std::string(pos_, it) + " to number"s);
+                }
+                pos_ = it;
+                return Node(value);
             }
-        }
+        };
 
     }  // namespace
 
@@ -271,79 +287,686 @@ namespace json {
     }
 
     Document Load(istream& input) {
-        return Document{LoadNode(input)};
+        //Поток читается целиком крупными блоками, разбор идёт по непрерывному буферу
+        std::string text;
+        char chunk[1 << 16];
+        while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+            text.append(chunk, static_cast<size_t>(input.gcount()));
+        }
+        return Load(std::string_view(text));
     }
 
-    //-------------------Функции вывода-------------------------------
+    Document Load(std::string_view text) {
+        return Document{BufferParser(text).ParseDocument()};
+    }
+
+    //-----------------Методы класса StreamReader--------------------
+
+    namespace {
+        //Вход потокового чтения дочитывается блоками такого размера
+        constexpr size_t STREAM_CHUNK_SIZE = 1 << 16;
+    }  // namespace
+
+    StreamReader::StreamReader(std::istream& input)
+            : input_(input) {
+    }
+
+    void StreamReader::Fail(const std::string& message) const {
+        throw ParsingError(message, consumed_ + pos_);
+    }
+
+    bool StreamReader::Fill() {
+        //Прочитанное отбрасывается, поэтому буфер не больше одного значения и блока входа
+        buffer_.erase(0, pos_);
+        consumed_ += pos_;
+        pos_ = 0;
+        const size_t size = buffer_.size();
+        buffer_.resize(size + STREAM_CHUNK_SIZE);
+        input_.read(buffer_.data() + size, static_cast<std::streamsize>(STREAM_CHUNK_SIZE));
+        buffer_.resize(size + static_cast<size_t>(input_.gcount()));
+        return buffer_.size() > size;
+    }
 
-    void PrintNode(const Node& node, std::ostream& out){
-        if(node.IsNull()){
-            out << "null"s;
+    bool StreamReader::Available(size_t length) {
+        while (pos_ + length >= buffer_.size()) {
+            if (!Fill()) {
+                return false;
+            }
         }
-        if(node.IsBool()){
-            if(node.AsBool()){
-                out << "true"s;
+        return true;
+    }
+
+    bool StreamReader::SkipSpaces() {
+        while (true) {
+            const char* data = buffer_.data();
+            pos_ = static_cast<size_t>(detail::SkipSpaces(data + pos_, data + buffer_.size()) - data);
+            if (pos_ < buffer_.size()) {
+                return true;
             }
-            else{
-                out << "false"s;
+            if (!Fill()) {
+                return false;
             }
         }
-        if(node.IsInt()) {
-            out << node.AsInt();
+    }
+
+    char StreamReader::NextChar() {
+        if (!SkipSpaces()) {
+            Fail("Unexpected end of the document"s);
+        }
+        return buffer_[pos_];
+    }
+
+    void StreamReader::Expect(char c, const std::string& message) {
+        if (NextChar() != c) {
+            Fail(message);
         }
-        if(node.IsDouble() && !node.IsInt()) {
-            out << node.AsDouble();
+        ++pos_;
+    }
+
+    size_t StreamReader::StringEnd(size_t length) {
+        ++length;
+        while (Available(length)) {
+            const char* data = buffer_.data();
+            const char* special = detail::FindStringSpecial(data + pos_ + length, data + buffer_.size());
+            length = static_cast<size_t>(special - data) - pos_;
+            if (special == data + buffer_.size()) {
+                continue;
+            }
+            if (*special == '"') {
+                return length + 1;
+            }
+            //Обратная косая черта вместе с экранированным символом
+            length += 2;
         }
-        if(node.IsString()) {
-            out << "\""s;
-            for (auto ch : node.AsString()) {
-                if (ch == '\n') {
-                    out << "\\n";
-                }
-                else if (ch == '\r') {
-                    out << "\\r";
+        //Строка не закончилась до конца входа: ошибку сообщит разбор
+        return std::min(length, buffer_.size() - pos_);
+    }
+
+    size_t StreamReader::BufferValue() {
+        //Здесь значение только ограничивается по скобкам и кавычкам, грамматику проверяет разбор
+        NextChar();
+        size_t length = 0;
+        size_t depth = 0;
+        while (Available(length)) {
+            const char c = buffer_[pos_ + length];
+            if (c == '"') {
+                length = StringEnd(length);
+            } else if (c == '[' || c == '{') {
+                ++depth;
+                ++length;
+                continue;
+            } else if (c == ']' || c == '}') {
+                if (depth == 0) {
+                    break;
                 }
-                else if (ch == '\t') {
-                    out << "\\t";
+                --depth;
+                ++length;
+            } else if (depth == 0 && (c == ',' || c == ':' || detail::IsSpace(c))) {
+                break;
+            } else {
+                ++length;
+                continue;
+            }
+            if (depth == 0) {
+                break;
+            }
+        }
+        return std::min(pos_ + length, buffer_.size());
+    }
+
+    void StreamReader::BeginObject() {
+        if (is_first_.size() >= detail::MAX_DEPTH) {
+            NextChar();
+            Fail("Document is nested too deeply"s);
+        }
+        Expect('{', "Object is expected"s);
+        is_first_.push_back(true);
+    }
+
+    bool StreamReader::NextKey(std::string& key) {
+        if (is_first_.empty()) {
+            Fail("No open object"s);
+        }
+        if (NextChar() == '}') {
+            ++pos_;
+            is_first_.pop_back();
+            return false;
+        }
+        if (!is_first_.back()) {
+            Expect(',', "Need ',' between dictionary items"s);
+        }
+        if (NextChar() != '"') {
+            Fail("Dictionary key is expected"s);
+        }
+        key = ReadValue().AsString();
+        Expect(':', "Need ':' after dictionary key"s);
+        is_first_.back() = false;
+        return true;
+    }
+
+    void StreamReader::BeginArray() {
+        if (is_first_.size() >= detail::MAX_DEPTH) {
+            NextChar();
+            Fail("Document is nested too deeply"s);
+        }
+        Expect('[', "Array is expected"s);
+        is_first_.push_back(true);
+    }
+
+    bool StreamReader::NextElement() {
+        if (is_first_.empty()) {
+            Fail("No open array"s);
+        }
+        if (NextChar() == ']') {
+            ++pos_;
+            is_first_.pop_back();
+            return false;
+        }
+        if (!is_first_.back()) {
+            Expect(',', "Need ',' between array items"s);
+        }
+        is_first_.back() = false;
+        return true;
+    }
+
+    Node StreamReader::ReadValue() {
+        const size_t end = BufferValue();
+        const char* data = buffer_.data();
+        BufferParser parser(data, data + pos_, data + end, is_first_.size());
+        try {
+            Node value = parser.ParseValue();
+            pos_ = static_cast<size_t>(parser.Position() - data);
+            return value;
+        } catch (const ParsingError& error) {
+            //Смещения разбора отсчитываются от начала буфера, а не входа
+            throw error.Shifted(consumed_);
+        }
+    }
+
+    void StreamReader::Finish() {
+        if (!is_first_.empty() || SkipSpaces()) {
+            Fail("Unexpected symbols after the document"s);
+        }
+    }
+
+    //-----------------Методы класса Cursor--------------------------
+
+    Cursor::Cursor(std::string_view text)
+            : begin_(text.data())
+            , pos_(text.data())
+            , end_(text.data() + text.size()) {
+    }
+
+    void Cursor::Fail(const std::string& message) const {
+        throw ParsingError(message, static_cast<size_t>(pos_ - begin_));
+    }
+
+    char Cursor::NextChar() {
+        pos_ = detail::SkipSpaces(pos_, end_);
+        if (pos_ == end_) {
+            Fail("Unexpected end of the document"s);
+        }
+        return *pos_;
+    }
+
+    void Cursor::Expect(char c, const std::string& message) {
+        if (NextChar() != c) {
+            Fail(message);
+        }
+        ++pos_;
+    }
+
+    Cursor::Type Cursor::Peek() {
+        switch (NextChar()) {
+            case '{': return Type::OBJECT;
+            case '[': return Type::ARRAY;
+            case '"': return Type::STRING;
+            case 't': [[fallthrough]];
+            case 'f': return Type::BOOL;
+            case 'n': return Type::NULL_VALUE;
+            default: return Type::NUMBER;
+        }
+    }
+
+    void Cursor::CheckDepth() {
+        //Вложенность курсора — число открытых объектов и массивов; Skip спускается по ним рекурсивно
+        if (is_first_.size() >= detail::MAX_DEPTH) {
+            NextChar();
+            Fail("Document is nested too deeply"s);
+        }
+    }
+
+    void Cursor::BeginObject() {
+        CheckDepth();
+        Expect('{', "Object is expected"s);
+        is_first_.push_back(true);
+    }
+
+    bool Cursor::NextKey(std::string_view& key) {
+        if (is_first_.empty()) {
+            Fail("No open object"s);
+        }
+        if (NextChar() == '}') {
+            ++pos_;
+            is_first_.pop_back();
+            return false;
+        }
+        if (!is_first_.back()) {
+            Expect(',', "Need ',' between dictionary items"s);
+        }
+        if (NextChar() != '"') {
+            Fail("Dictionary key is expected"s);
+        }
+        key = ScanString();
+        Expect(':', "Need ':' after dictionary key"s);
+        is_first_.back() = false;
+        return true;
+    }
+
+    void Cursor::BeginArray() {
+        CheckDepth();
+        Expect('[', "Array is expected"s);
+        is_first_.push_back(true);
+    }
+
+    bool Cursor::NextElement() {
+        if (is_first_.empty()) {
+            Fail("No open array"s);
+        }
+        if (NextChar() == ']') {
+            ++pos_;
+            is_first_.pop_back();
+            return false;
+        }
+        if (!is_first_.back()) {
+            Expect(',', "Need ',' between array items"s);
+        }
+        is_first_.back() = false;
+        return true;
+    }
+
+    std::string_view Cursor::ScanString() {
+        const char* start = ++pos_;
+        const char* special = detail::FindStringSpecial(pos_, end_);
+        if (special != end_ && *special == '"') {
+            pos_ = special + 1;
+            return {start, static_cast<size_t>(special - start)};
+        }
+        scratch_.clear();
+        while (true) {
+            scratch_.append(pos_, special);
+            pos_ = special;
+            if (pos_ == end_) {
+                Fail("No '\"' symbol in the end of the string"s);
+            }
+            if (*pos_ == '"') {
+                ++pos_;
+                return scratch_;
+            }
+            if (++pos_ == end_) {
+                Fail("No '\"' symbol in the end of the string"s);
+            }
+            char unescaped;
+            if (!detail::Unescape(*pos_, unescaped)) {
+                Fail("Invalid escape sequence"s);
+            }
+            scratch_ += unescaped;
+            special = detail::FindStringSpecial(++pos_, end_);
+        }
+    }
+
+    std::string_view Cursor::ReadString() {
+        if (NextChar() != '"') {
+            Fail("String is expected"s);
+        }
+        return ScanString();
+    }
+
+    int Cursor::ReadInt() {
+        NextChar();
+        bool is_int;
+        const char* end = detail::ScanNumber(begin_, pos_, end_, is_int);
+        int value;
+        if (const auto result = std::from_chars(pos_, end, value); !is_int || result.ec != std::errc{}) {
+            Fail("Integer is expected"s);
+        }
+        pos_ = end;
+        return value;
+    }
+
+    double Cursor::ReadDouble() {
+        NextChar();
+        bool is_int;
+        const char* end = detail::ScanNumber(begin_, pos_, end_, is_int);
+        double value;
+        if (const auto result = std::from_chars(pos_, end, value); result.ec != std::errc{} || result.ptr != end) {
+            Fail("Failed to convert "s + std::string(pos_, end) + " to number"s);
+        }
+        pos_ = end;
+        return value;
+    }
+
+    bool Cursor::ReadBool() {
+        for (const auto& [literal, value] : {std::pair{"true"sv, true}, std::pair{"false"sv, false}}) {
+            if (NextChar() == literal.front() && static_cast<size_t>(end_ - pos_) >= literal.size()
+                && std::string_view(pos_, literal.size()) == literal) {
+                pos_ += literal.size();
+                return value;
+            }
+        }
+        Fail("Bool is expected"s);
+    }
+
+    Node Cursor::ReadValue() {
+        NextChar();
+        BufferParser parser(begin_, pos_, end_, is_first_.size());
+        Node value = parser.ParseValue();
+        pos_ = parser.Position();
+        return value;
+    }
+
+    void Cursor::Skip() {
+        switch (Peek()) {
+            case Type::OBJECT: {
+                BeginObject();
+                std::string_view key;
+                while (NextKey(key)) {
+                    Skip();
                 }
-                else if (ch == '\\') {
-                    out << "\\\\";
+                break;
+            }
+            case Type::ARRAY:
+                BeginArray();
+                while (NextElement()) {
+                    Skip();
                 }
-                else if (ch == '"') {
-                    out << "\\\"";
+                break;
+            case Type::STRING:
+                ReadString();
+                break;
+            case Type::BOOL:
+                ReadBool();
+                break;
+            case Type::NUMBER:
+                //Число преобразуется, как в json::Load: грамматики мало, 1e400 не помещается в double
+                ReadDouble();
+                break;
+            case Type::NULL_VALUE:
+                if (static_cast<size_t>(end_ - pos_) < 4 || std::string_view(pos_, 4) != "null"sv) {
+                    Fail("Unknown literal"s);
                 }
-                else {
-                    out << ch;
+                pos_ += 4;
+                break;
+        }
+    }
+
+    void Cursor::Finish() {
+        pos_ = detail::SkipSpaces(pos_, end_);
+        if (!is_first_.empty() || pos_ != end_) {
+            Fail("Unexpected symbols after the document"s);
+        }
+    }
+
+    //-----------------Методы класса Writer--------------------------
+
+    namespace {
+        //Размер буфера, после которого данные сбрасываются в поток
+        constexpr size_t WRITER_FLUSH_THRESHOLD = 1 << 16;
+
+        //Для каждого байта — вторая буква escape-последовательности или 0, если байт печатается как есть.
+        //Экранируются те же символы, что и раньше: прочие управляющие символы выводятся без изменений
+        constexpr auto ESCAPES = [] {
+            std::array<char, 256> table{};
+            table['\n'] = 'n';
+            table['\r'] = 'r';
+            table['\t'] = 't';
+            table['"'] = '"';
+            table['\\'] = '\\';
+            return table;
+        }();
+
+        //Пропускает символы, которые не нужно экранировать: все, кроме кавычки, обратной черты и управляющих
+        const char* FindEscape(const char* it, const char* end) {
+#ifdef __SSE2__
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i control = _mm_set1_epi8(0x1F);
+            while (end - it >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+                const __m128i special = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                        _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+                if (const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special)); mask != 0) {
+                    return it + __builtin_ctz(mask);
                 }
+                it += 16;
+            }
+#endif
+            while (it != end && !ESCAPES[static_cast<unsigned char>(*it)]) {
+                ++it;
+            }
+            return it;
+        }
+    }  // namespace
+
+    void AppendEscaped(std::string& target, std::string_view value) {
+        const char* it = value.data();
+        const char* end = value.data() + value.size();
+        while (true) {
+            const char* special = FindEscape(it, end);
+            target.append(it, special);
+            if (special == end) {
+                break;
+            }
+            if (const char escape = ESCAPES[static_cast<unsigned char>(*special)]) {
+                target += '\\';
+                target += escape;
+            } else {
+                target += *special;
+            }
+            it = special + 1;
+        }
+    }
+
+    //-----------------Методы класса EscapingBuffer------------------
+
+    EscapingBuffer::EscapingBuffer(std::string& target)
+            : target_(target) {
+    }
+
+    EscapingBuffer::int_type EscapingBuffer::overflow(int_type ch) {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            const char c = traits_type::to_char_type(ch);
+            AppendEscaped(target_, std::string_view(&c, 1));
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize EscapingBuffer::xsputn(const char* data, std::streamsize size) {
+        AppendEscaped(target_, std::string_view(data, static_cast<size_t>(size)));
+        return size;
+    }
+
+    Writer::Writer(std::ostream& output, Format format, DoubleFormat double_format)
+            : output_(output)
+            , format_(format)
+            , double_format_(double_format) {
+        buffer_.reserve(WRITER_FLUSH_THRESHOLD * 2);
+    }
+
+    Writer::~Writer() {
+        Flush();
+    }
+
+    void Writer::Flush() {
+        if (!buffer_.empty()) {
+            output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
+    }
+
+    void Writer::FlushIfFull() {
+        if (buffer_.size() >= WRITER_FLUSH_THRESHOLD) {
+            Flush();
+        }
+    }
+
+    void Writer::BeforeValue() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (!is_first_.empty()) {
+            if (!is_first_.back()) {
+                buffer_ += format_ == Format::COMPACT ? ","sv : ",\n"sv;
+            }
+            is_first_.back() = false;
+        }
+    }
+
+    void Writer::Null() {
+        BeforeValue();
+        buffer_ += "null"sv;
+    }
+
+    void Writer::Bool(bool value) {
+        BeforeValue();
+        buffer_ += value ? "true"sv : "false"sv;
+    }
+
+    void Writer::Int(int value) {
+        BeforeValue();
+        char digits[16];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer_.append(digits, result.ptr);
+    }
+
+    void Writer::Double(double value) {
+        BeforeValue();
+        char digits[32];
+        //COMPAT — формат %g с точностью 6, как у std::ostream по умолчанию
+        const auto result = double_format_ == DoubleFormat::COMPAT
+                            ? std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6)
+                            : std::to_chars(digits, digits + sizeof(digits), value);
+        buffer_.append(digits, result.ptr);
+    }
+
+    void Writer::String(std::string_view value) {
+        BeforeValue();
+        AppendString(value);
+        FlushIfFull();
+    }
+
+    void Writer::EscapedString(std::string_view escaped) {
+        EscapedString({escaped});
+    }
+
+    void Writer::EscapedString(std::initializer_list<std::string_view> escaped_parts) {
+        BeforeValue();
+        buffer_ += '"';
+        for (const std::string_view escaped : escaped_parts) {
+            //Большие части передаются в поток напрямую, минуя буфер
+            if (escaped.size() >= WRITER_FLUSH_THRESHOLD) {
+                Flush();
+                output_.write(escaped.data(), static_cast<std::streamsize>(escaped.size()));
+            } else {
+                buffer_ += escaped;
             }
-            out << "\""s;
         }
-        if(node.IsMap()){
-            out << "{\n"s;
-            bool is_first = true;
+        buffer_ += '"';
+        FlushIfFull();
+    }
+
+    void Writer::AppendString(std::string_view value) {
+        buffer_ += '"';
+        AppendEscaped(buffer_, value);
+        buffer_ += '"';
+    }
+
+    void Writer::Key(std::string_view key) {
+        if (is_first_.empty() || !is_dict_.back() || after_key_) {
+            throw std::logic_error("Key outside of a dictionary");
+        }
+        BeforeValue();
+        //Ключи выводятся без экранирования, как и раньше
+        buffer_ += '"';
+        buffer_ += key;
+        buffer_ += format_ == Format::COMPACT ? "\":"sv : "\": "sv;
+        after_key_ = true;
+    }
+
+    void Writer::StartDict() {
+        BeforeValue();
+        buffer_ += format_ == Format::COMPACT ? "{"sv : "{\n"sv;
+        is_first_.push_back(true);
+        is_dict_.push_back(true);
+    }
+
+    void Writer::EndDict() {
+        if (is_first_.empty() || !is_dict_.back() || after_key_) {
+            throw std::logic_error("No dictionary to end");
+        }
+        is_first_.pop_back();
+        is_dict_.pop_back();
+        buffer_ += format_ == Format::COMPACT ? "}"sv : "\n}"sv;
+        FlushIfFull();
+    }
+
+    void Writer::StartArray() {
+        BeforeValue();
+        buffer_ += format_ == Format::COMPACT ? "["sv : "[\n"sv;
+        is_first_.push_back(true);
+        is_dict_.push_back(false);
+    }
+
+    void Writer::EndArray() {
+        if (is_first_.empty() || is_dict_.back()) {
+            throw std::logic_error("No array to end");
+        }
+        is_first_.pop_back();
+        is_dict_.pop_back();
+        buffer_ += format_ == Format::COMPACT ? "]"sv : "\n]"sv;
+        FlushIfFull();
+    }
+
+    void Writer::Value(const Node& node) {
+        if (node.IsNull()) {
+            Null();
+        }
+        else if (node.IsBool()) {
+            Bool(node.AsBool());
+        }
+        else if (node.IsInt()) {
+            Int(node.AsInt());
+        }
+        else if (node.IsDouble()) {
+            Double(node.AsDouble());
+        }
+        else if (node.IsString()) {
+            String(node.AsString());
+        }
+        else if (node.IsMap()) {
+            StartDict();
             for (const auto& [key, value] : node.AsMap()) {
-                out << (!is_first ? ",\n" : "") << "\"" << key << "\": ";
-                PrintNode(value, out);
-                is_first = false;
-            }
-            out << "\n}"s;
-        }
-        if(node.IsArray()){
-            out << "[\n"s;
-            bool is_first = true;
-            for(const auto& elem : node.AsArray()){
-                if(!is_first){
-                    out << ",\n";
-                }
-                PrintNode(elem, out);
-                is_first = false;
+                Key(key);
+                Value(value);
             }
-            out << "\n]"s;
+            EndDict();
+        }
+        else {
+            StartArray();
+            for (const auto& elem : node.AsArray()) {
+                Value(elem);
+            }
+            EndArray();
         }
     }
 
+    //-------------------Функции вывода-------------------------------
+
     void Print(const Document& doc, std::ostream& output) {
-        PrintNode(doc.GetRoot(), output);
+        Writer writer(output);
+        writer.Value(doc.GetRoot());
     }
 
 }  // namespace json
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <initializer_list>
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
+#include <stdexcept>
 #include <sstream>
 #include <vector>
 #include <variant>
@@ -17,6 +20,27 @@ namespace json {
     class ParsingError : public std::runtime_error {
     public:
         using runtime_error::runtime_error;
+
+        // offset — смещение ошибки от начала разбираемого текста, добавляется к сообщению
+        ParsingError(const std::string& message, size_t offset)
+                : runtime_error(message + " at offset " + std::to_string(offset))
+                , message_(message)
+                , offset_(offset) {
+        }
+
+        // Смещение ошибки или npos, если оно неизвестно
+        size_t Offset() const {
+            return offset_;
+        }
+
+        // Та же ошибка со смещением от начала, лежащего на base байт раньше (для разбора текста по частям)
+        ParsingError Shifted(size_t base) const {
+            return offset_ == std::string::npos ? *this : ParsingError(message_, offset_ + base);
+        }
+
+    private:
+        std::string message_;
+        size_t offset_ = std::string::npos;
     };
 
     class Node final
@@ -69,7 +93,195 @@ namespace json {
         Node root_;
     };
 
+    // Поток читается до конца и разбирается как один документ
     Document Load(std::istream& input);
+    // Разбор документа, целиком лежащего в памяти
+    Document Load(std::string_view text);
+
+    // Потоковое чтение документа без построения всего дерева:
+    // объекты и массивы обходятся поэлементно, значения элементов разбираются по одному.
+    // Вход читается блоками в буфер, в котором остаётся только непрочитанная часть; значение
+    // дочитывается целиком и разбирается тем же разбором, что и json::Load, со смещениями от начала входа
+    class StreamReader {
+    public:
+        explicit StreamReader(std::istream& input);
+
+        // Ожидает начало объекта '{'
+        void BeginObject();
+        // Читает очередной ключ текущего объекта. Возвращает false, если объект закончился
+        bool NextKey(std::string& key);
+        // Ожидает начало массива '['
+        void BeginArray();
+        // Переходит к очередному элементу текущего массива. Возвращает false, если массив закончился
+        bool NextElement();
+        // Разбирает очередное значение целиком
+        Node ReadValue();
+        // Дочитывает очередное значение и передаёт его курсору: read(cursor) читает значение без построения дерева
+        template <typename Read>
+        void ReadValue(Read read);
+        // Проверяет, что документ закончился
+        void Finish();
+
+    private:
+        std::istream& input_;
+        std::string buffer_;         // непрочитанный остаток входа
+        size_t pos_ = 0;             // позиция чтения в buffer_
+        size_t consumed_ = 0;        // смещение buffer_[0] от начала входа
+        std::vector<bool> is_first_; // для каждого открытого объекта/массива: ещё не было элементов
+
+        [[noreturn]] void Fail(const std::string& message) const;
+        // Дочитывает блок входа, отбрасывая прочитанное. false, если вход закончился
+        bool Fill();
+        // Дочитывает вход, пока в буфере не окажется символ pos_ + length. false, если вход закончился раньше
+        bool Available(size_t length);
+        // Пропускает пробелы. false, если вход закончился
+        bool SkipSpaces();
+        char NextChar();
+        void Expect(char c, const std::string& message);
+        // Дочитывает следующее значение целиком, возвращает его конец в buffer_
+        size_t BufferValue();
+        // Длина от pos_ до конца строки, кавычка которой стоит на pos_ + length
+        size_t StringEnd(size_t length);
+    };
+
+    // Курсор по документу, целиком лежащему в памяти: значения читаются по одному в порядке текста,
+    // дерево не строится. Строки и ключи ссылаются на текст или на внутренний буфер курсора
+    // и действительны до следующего чтения
+    class Cursor {
+    public:
+        enum class Type {
+            NULL_VALUE,
+            BOOL,
+            NUMBER,
+            STRING,
+            ARRAY,
+            OBJECT,
+        };
+
+        explicit Cursor(std::string_view text);
+
+        // Тип следующего значения
+        Type Peek();
+
+        // Ожидает начало объекта '{'
+        void BeginObject();
+        // Читает очередной ключ текущего объекта. Возвращает false, если объект закончился
+        bool NextKey(std::string_view& key);
+        // Ожидает начало массива '['
+        void BeginArray();
+        // Переходит к очередному элементу текущего массива. Возвращает false, если массив закончился
+        bool NextElement();
+
+        std::string_view ReadString();
+        int ReadInt();
+        double ReadDouble();
+        bool ReadBool();
+        // Разбирает следующее значение целиком (для небольших частей документа)
+        Node ReadValue();
+        // Пропускает следующее значение
+        void Skip();
+        // Проверяет, что документ закончился
+        void Finish();
+
+    private:
+        const char* begin_;
+        const char* pos_;
+        const char* end_;
+        std::vector<bool> is_first_; // для каждого открытого объекта/массива: ещё не было элементов
+        std::string scratch_;        // раскодированная строка с escape-последовательностями
+
+        [[noreturn]] void Fail(const std::string& message) const;
+        char NextChar();
+        void Expect(char c, const std::string& message);
+        std::string_view ScanString();
+        // Бросает ParsingError, если следующий объект или массив превысит detail::MAX_DEPTH
+        void CheckDepth();
+    };
+
+    template <typename Read>
+    void StreamReader::ReadValue(Read read) {
+        const size_t end = BufferValue();
+        const size_t begin = pos_;
+        Cursor cursor(std::string_view(buffer_).substr(begin, end - begin));
+        try {
+            read(cursor);
+            cursor.Finish();
+        } catch (const ParsingError& error) {
+            //Смещения курсора отсчитываются от начала значения, а не входа
+            throw error.Shifted(consumed_ + begin);
+        }
+        pos_ = end;
+    }
+
+    // Буферизованный вывод JSON: данные копятся во внутреннем буфере и передаются в поток крупными блоками.
+    // Значения внутри словаря предваряются Key. Буфер сбрасывается в Flush и в деструкторе
+    class Writer {
+    public:
+        enum class Format {
+            PRETTY,  // как Print: каждый элемент словаря и массива с новой строки
+            COMPACT, // весь документ в одну строку без пробелов
+        };
+        enum class DoubleFormat {
+            COMPAT,   // %g с точностью 6, как std::ostream по умолчанию
+            SHORTEST, // кратчайшая запись, которая читается обратно в то же число
+        };
+
+        explicit Writer(std::ostream& output, Format format = Format::PRETTY,
+                        DoubleFormat double_format = DoubleFormat::COMPAT);
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer();
+
+        void Null();
+        void Bool(bool value);
+        void Int(int value);
+        void Double(double value);
+        void String(std::string_view value);
+        // Строка, уже экранированная по правилам JSON (например, через EscapingBuffer), выводится как есть
+        void EscapedString(std::string_view escaped);
+        // Одна экранированная строка, составленная из частей без склейки в памяти
+        void EscapedString(std::initializer_list<std::string_view> escaped_parts);
+        void Key(std::string_view key);
+        void StartDict();
+        void EndDict();
+        void StartArray();
+        void EndArray();
+        // Выводит значение целиком
+        void Value(const Node& node);
+
+        // Передаёт накопленное в поток (сам поток не сбрасывается)
+        void Flush();
+
+    private:
+        std::ostream& output_;
+        Format format_;
+        DoubleFormat double_format_;
+        std::string buffer_;
+        std::vector<bool> is_first_; // для каждого открытого словаря/массива: ещё не было элементов
+        std::vector<bool> is_dict_;
+        bool after_key_ = false;
+
+        void BeforeValue();
+        void AppendString(std::string_view value);
+        void FlushIfFull();
+    };
+
+    // Дописывает value в target, экранируя символы так же, как Writer
+    void AppendEscaped(std::string& target, std::string_view value);
+
+    // Буфер потока, который экранирует всё записанное в него по правилам строк JSON и дописывает в target.
+    // Позволяет вывести текст (например, SVG) внутрь строки JSON за один проход без промежуточных копий
+    class EscapingBuffer : public std::streambuf {
+    public:
+        explicit EscapingBuffer(std::string& target);
+
+    protected:
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char* data, std::streamsize size) override;
+
+    private:
+        std::string& target_;
+    };
 
     void Print(const Document& doc, std::ostream& output);
 
@@ -0,0 +1,380 @@
+#include "json_arena.h"
+#include "json_scan.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <memory>
+
+namespace json::arena {
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+
+    namespace {
+        //Первый блок арены; следующие вдвое больше предыдущего, но не больше MAX_BLOCK_SIZE
+        constexpr size_t MIN_BLOCK_SIZE = 1 << 12;
+        constexpr size_t MAX_BLOCK_SIZE = 1 << 22;
+    }//namespace
+
+    //---------------------Разбор документа--------------------------
+
+    // Разбирает текст в арену. Элементы ещё не закрытых массивов и объектов копятся
+    // в общих стеках и переносятся в арену одним блоком, когда их количество известно
+    class Parser {
+    public:
+        Parser(std::string_view text, Arena& arena)
+                : begin_(text.data())
+                , pos_(text.data())
+                , end_(text.data() + text.size())
+                , arena_(arena) {
+        }
+
+        Value ParseDocument() {
+            Value root = ParseValue();
+            pos_ = detail::SkipSpaces(pos_, end_);
+            if (pos_ != end_) {
+                Fail("Unexpected symbols after the document"s);
+            }
+            return root;
+        }
+
+    private:
+        const char* begin_;
+        const char* pos_;
+        const char* end_;
+        Arena& arena_;
+        size_t depth_ = 0;
+        std::vector<Value> values_;
+        std::vector<Member> members_;
+        std::string unescaped_;
+
+        [[noreturn]] void Fail(const std::string& message) const {
+            throw ParsingError(message, static_cast<size_t>(pos_ - begin_));
+        }
+
+        char Next() {
+            pos_ = detail::SkipSpaces(pos_, end_);
+            if (pos_ == end_) {
+                Fail("Unexpected end of the document"s);
+            }
+            return *pos_;
+        }
+
+        static void CheckSize(size_t size) {
+            if (size > UINT32_MAX) {
+                throw ParsingError("Too many elements in JSON value"s);
+            }
+        }
+
+        Value ParseValue() {
+            Value value;
+            switch (Next()) {
+                case '[':
+                    return ParseArray();
+                case '{':
+                    return ParseObject();
+                case '"': {
+                    const std::string_view str = ParseString();
+                    value.type_ = Value::Type::STRING;
+                    value.size_ = static_cast<uint32_t>(str.size());
+                    value.string_ = str.data();
+                    return value;
+                }
+                case 't':
+                    ParseLiteral("true"sv);
+                    value.type_ = Value::Type::BOOL;
+                    value.bool_ = true;
+                    return value;
+                case 'f':
+                    ParseLiteral("false"sv);
+                    value.type_ = Value::Type::BOOL;
+                    value.bool_ = false;
+                    return value;
+                case 'n':
+                    ParseLiteral("null"sv);
+                    return value;
+                default:
+                    return ParseNumber();
+            }
+        }
+
+        Value ParseArray() {
+            const detail::DepthGuard guard(depth_, begin_, pos_);
+            ++pos_;
+            const size_t mark = values_.size();
+            if (Next() == ']') {
+                ++pos_;
+            } else {
+                while (true) {
+                    Value item = ParseValue();
+                    values_.push_back(item);
+                    const char c = Next();
+                    if (c == ']') {
+                        ++pos_;
+                        break;
+                    }
+                    if (c != ',') {
+                        Fail("Need ',' or ']' in array"s);
+                    }
+                    ++pos_;
+                }
+            }
+            const size_t size = values_.size() - mark;
+            CheckSize(size);
+            Value* items = arena_.AllocateArray<Value>(size);
+            std::uninitialized_copy(values_.begin() + static_cast<std::ptrdiff_t>(mark), values_.end(), items);
+            values_.resize(mark);
+
+            Value result;
+            result.type_ = Value::Type::ARRAY;
+            result.size_ = static_cast<uint32_t>(size);
+            result.items_ = items;
+            return result;
+        }
+
+        Value ParseObject() {
+            const detail::DepthGuard guard(depth_, begin_, pos_);
+            ++pos_;
+            const size_t mark = members_.size();
+            if (Next() == '}') {
+                ++pos_;
+            } else {
+                while (true) {
+                    if (Next() != '"') {
+                        Fail("Dictionary key is expected"s);
+                    }
+                    const std::string_view key = ParseString();
+                    if (Next() != ':') {
+                        Fail("Need ':' after dictionary key"s);
+                    }
+                    ++pos_;
+                    Value value = ParseValue();
+                    members_.push_back({key, value});
+                    const char c = Next();
+                    if (c == '}') {
+                        ++pos_;
+                        break;
+                    }
+                    if (c != ',') {
+                        Fail("Need ',' or '}' in dictionary"s);
+                    }
+                    ++pos_;
+                }
+            }
+
+            //Сортировка устойчива, поэтому из повторяющихся ключей остаётся первый
+            const auto first = members_.begin() + static_cast<std::ptrdiff_t>(mark);
+            std::stable_sort(first, members_.end(), [](const Member& lhs, const Member& rhs) {
+                return lhs.key < rhs.key;
+            });
+            members_.erase(std::unique(first, members_.end(), [](const Member& lhs, const Member& rhs) {
+                return lhs.key == rhs.key;
+            }), members_.end());
+
+            const size_t size = members_.size() - mark;
+            CheckSize(size);
+            Member* members = arena_.AllocateArray<Member>(size);
+            std::uninitialized_copy(members_.begin() + static_cast<std::ptrdiff_t>(mark), members_.end(), members);
+            members_.resize(mark);
+
+            Value result;
+            result.type_ = Value::Type::OBJECT;
+            result.size_ = static_cast<uint32_t>(size);
+            result.members_ = members;
+            return result;
+        }
+
+        //Строка без escape-последовательностей возвращается как ссылка на текст документа,
+        //иначе раскодированная копия кладётся в арену
+        std::string_view ParseString() {
+            const char* start = ++pos_;
+            const char* special = detail::FindStringSpecial(pos_, end_);
+            if (special != end_ && *special == '"') {
+                pos_ = special + 1;
+                CheckSize(static_cast<size_t>(special - start));
+                return {start, static_cast<size_t>(special - start)};
+            }
+
+            unescaped_.clear();
+            while (true) {
+                unescaped_.append(pos_, special);
+                pos_ = special;
+                if (pos_ == end_) {
+                    Fail("No '\"' symbol in the end of the string"s);
+                }
+                if (*pos_ == '"') {
+                    ++pos_;
+                    break;
+                }
+                if (++pos_ == end_) {
+                    Fail("No '\"' symbol in the end of the string"s);
+                }
+                char unescaped;
+                if (!detail::Unescape(*pos_, unescaped)) {
+                    Fail("Invalid escape sequence"s);
+                }
+                unescaped_ += unescaped;
+                special = detail::FindStringSpecial(++pos_, end_);
+            }
+            CheckSize(unescaped_.size());
+            char* copy = arena_.AllocateArray<char>(unescaped_.size());
+            std::memcpy(copy, unescaped_.data(), unescaped_.size());
+            return {copy, unescaped_.size()};
+        }
+
+        void ParseLiteral(std::string_view literal) {
+            if (static_cast<size_t>(end_ - pos_) < literal.size()
+                || std::string_view(pos_, literal.size()) != literal) {
+                Fail("Unknown literal"s);
+            }
+            pos_ += literal.size();
+        }
+
+        Value ParseNumber() {
+            bool is_int;
+            const char* it = detail::ScanNumber(begin_, pos_, end_, is_int);
+            Value result;
+            if (is_int) {
+                if (const auto parsed = std::from_chars(pos_, it, result.int_); parsed.ec == std::errc{}) {
+                    result.type_ = Value::Type::INT;
+                    pos_ = it;
+                    return result;
+                }
+                //При переполнении int число читается как double
+            }
+            if (const auto parsed = std::from_chars(pos_, it, result.double_);
+                    parsed.ec != std::errc{} || parsed.ptr != it) {
+                Fail("Failed to convert "s + std::string(pos_, it) + " to number"s);
+            }
+            result.type_ = Value::Type::DOUBLE;
+            pos_ = it;
+            return result;
+        }
+    };
+
+    //---------------------Методы класса Object----------------------
+
+    const Value* Object::Find(std::string_view key) const {
+        const auto it = std::lower_bound(begin(), end(), key, [](const Member& member, std::string_view key) {
+            return member.key < key;
+        });
+        return it != end() && it->key == key ? &it->value : nullptr;
+    }
+
+    const Value& Object::at(std::string_view key) const {
+        if (const Value* value = Find(key)) {
+            return *value;
+        }
+        throw std::out_of_range("No key "s + std::string(key) + " in JSON object"s);
+    }
+
+    size_t Object::count(std::string_view key) const {
+        return Find(key) ? 1 : 0;
+    }
+
+    //---------------------Методы класса Value-----------------------
+
+    bool Value::IsNull() const {
+        return type_ == Type::NULL_VALUE;
+    }
+    bool Value::IsArray() const {
+        return type_ == Type::ARRAY;
+    }
+    Range<Value> Value::AsArray() const {
+        if (!IsArray()) {
+            throw std::logic_error("Not an array");
+        }
+        return {items_, size_};
+    }
+    bool Value::IsMap() const {
+        return type_ == Type::OBJECT;
+    }
+    Object Value::AsMap() const {
+        if (!IsMap()) {
+            throw std::logic_error("Not a map");
+        }
+        return {members_, size_};
+    }
+    bool Value::IsInt() const {
+        return type_ == Type::INT;
+    }
+    int Value::AsInt() const {
+        if (!IsInt()) {
+            throw std::logic_error("Not an integer");
+        }
+        return int_;
+    }
+    bool Value::IsDouble() const {
+        return type_ == Type::DOUBLE || type_ == Type::INT;
+    }
+    bool Value::IsPureDouble() const {
+        return type_ == Type::DOUBLE;
+    }
+    double Value::AsDouble() const {
+        if (IsInt()) {
+            return static_cast<double>(int_);
+        }
+        if (!IsPureDouble()) {
+            throw std::logic_error("Not a real number");
+        }
+        return double_;
+    }
+    bool Value::IsBool() const {
+        return type_ == Type::BOOL;
+    }
+    bool Value::AsBool() const {
+        if (!IsBool()) {
+            throw std::logic_error("Not a bool");
+        }
+        return bool_;
+    }
+    bool Value::IsString() const {
+        return type_ == Type::STRING;
+    }
+    std::string_view Value::AsString() const {
+        if (!IsString()) {
+            throw std::logic_error("Not a string");
+        }
+        return {string_, size_};
+    }
+
+    //---------------------Методы класса Arena-----------------------
+
+    void* Arena::Allocate(size_t size, size_t align) {
+        auto aligned = [align](char* pos) {
+            return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(pos) + align - 1) & ~(uintptr_t{align} - 1));
+        };
+        char* result = aligned(pos_);
+        if (!pos_ || result + size > end_) {
+            const size_t previous = block_size_ == 0 ? MIN_BLOCK_SIZE / 2 : block_size_;
+            block_size_ = std::max(std::min(previous * 2, MAX_BLOCK_SIZE), size + align);
+            blocks_.push_back(std::make_unique<char[]>(block_size_));
+            pos_ = blocks_.back().get();
+            end_ = pos_ + block_size_;
+            result = aligned(pos_);
+        }
+        pos_ = result + size;
+        return result;
+    }
+
+    //---------------------Методы класса Document--------------------
+
+    Document::Document(std::string text)
+            : text_(std::make_unique<const std::string>(std::move(text))) {
+        root_ = Parser(*text_, arena_).ParseDocument();
+    }
+
+    const Value& Document::GetRoot() const {
+        return root_;
+    }
+
+    Document Load(std::istream& input) {
+        std::string text;
+        char chunk[1 << 16];
+        while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+            text.append(chunk, static_cast<size_t>(input.gcount()));
+        }
+        return Document(std::move(text));
+    }
+
+}//namespace json::arena
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+// Компактное представление JSON-документа для больших входных данных.
+// Узлы лежат в арене документа, объекты хранятся плоскими массивами пар, отсортированными по ключу,
+// строки без escape-последовательностей ссылаются прямо на текст документа.
+// Документ неизменяем; значения действительны, пока жив документ
+namespace json::arena {
+
+    class Value;
+    struct Member;
+
+    // Непрерывный диапазон элементов в арене документа
+    template <typename T>
+    class Range {
+    public:
+        Range() = default;
+        Range(const T* data, size_t size)
+                : data_(data)
+                , size_(size) {
+        }
+
+        const T* begin() const {
+            return data_;
+        }
+        const T* end() const {
+            return data_ + size_;
+        }
+        size_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+        const T& operator[](size_t index) const {
+            return data_[index];
+        }
+        const T& at(size_t index) const {
+            if (index >= size_) {
+                throw std::out_of_range("Index is out of range");
+            }
+            return data_[index];
+        }
+        const T& front() const {
+            return at(0);
+        }
+        const T& back() const {
+            return at(size_ - 1);
+        }
+
+    private:
+        const T* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Объект: пары отсортированы по ключу, ключи уникальны (при повторе остаётся первый, как в json::Dict)
+    class Object : public Range<Member> {
+    public:
+        using Range::Range;
+
+        // Двоичный поиск по ключу, nullptr если ключа нет
+        const Value* Find(std::string_view key) const;
+        const Value& at(std::string_view key) const;
+        size_t count(std::string_view key) const;
+    };
+
+    // Значение занимает 16 байт: тип, длина массива/объекта/строки и данные или указатель в арену
+    class Value {
+    public:
+        Value() = default;
+
+        bool IsNull() const;
+        bool IsArray() const;
+        Range<Value> AsArray() const;
+        bool IsMap() const;
+        Object AsMap() const;
+        bool IsInt() const;
+        int AsInt() const;
+        bool IsDouble() const;
+        bool IsPureDouble() const;
+        double AsDouble() const;
+        bool IsBool() const;
+        bool AsBool() const;
+        bool IsString() const;
+        std::string_view AsString() const;
+
+    private:
+        friend class Parser;
+
+        enum class Type : uint8_t {
+            NULL_VALUE,
+            BOOL,
+            INT,
+            DOUBLE,
+            STRING,
+            ARRAY,
+            OBJECT,
+        };
+
+        Type type_ = Type::NULL_VALUE;
+        uint32_t size_ = 0;
+        union {
+            const void* data_ = nullptr;
+            bool bool_;
+            int int_;
+            double double_;
+            const char* string_;
+            const Value* items_;
+            const Member* members_;
+        };
+    };
+
+    struct Member {
+        std::string_view key;
+        Value value;
+    };
+
+    // Линейный распределитель: память выделяется блоками растущего размера и освобождается только целиком.
+    // Адреса выделенных объектов не меняются при перемещении арены
+    class Arena {
+    public:
+        void* Allocate(size_t size, size_t align);
+
+        template <typename T>
+        T* AllocateArray(size_t count) {
+            return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        }
+
+    private:
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        size_t block_size_ = 0; // размер последнего блока, следующий вдвое больше
+        char* pos_ = nullptr;
+        char* end_ = nullptr;
+    };
+
+    class Document {
+    public:
+        // Разбирает text и хранит его у себя: строки документа ссылаются на этот текст
+        explicit Document(std::string text);
+
+        const Value& GetRoot() const;
+
+    private:
+        std::unique_ptr<const std::string> text_;
+        Arena arena_;
+        Value root_;
+    };
+
+    // Поток читается до конца и разбирается как один документ
+    Document Load(std::istream& input);
+
+}//namespace json::arena
@@ -8,7 +8,35 @@ Builder::Builder() {
     nodes_stack_.push_back(&root_);
 }
 
+Builder::Builder(Writer& writer)
+        : writer_(&writer) {
+}
+
+//Значение допустимо в корне документа, в массиве и после ключа
+void Builder::BeginSinkValue(const char* method) {
+    if (scopes_.empty() ? is_done_ : scopes_.back() == Scope::DICT) {
+        throw std::logic_error(std::string(method) + " method call error");
+    }
+    if (!scopes_.empty() && scopes_.back() == Scope::DICT_VALUE) {
+        scopes_.pop_back();
+    }
+}
+
+void Builder::EndSinkValue() {
+    if (scopes_.empty()) {
+        is_done_ = true;
+    }
+}
+
 KeyItemContext Builder::Key(std::string key) {
+    if (writer_) {
+        if (scopes_.empty() || scopes_.back() != Scope::DICT) {
+            throw std::logic_error("Calling the Key method outside the dictionary");
+        }
+        writer_->Key(key);
+        scopes_.push_back(Scope::DICT_VALUE);
+        return *this;
+    }
     if(!IsMap()){
         throw std::logic_error("Calling the Key method outside the dictionary");
     }
@@ -19,6 +47,12 @@ KeyItemContext Builder::Key(std::string key) {
 }
 
 Builder &Builder::Value(Node value) {
+    if (writer_) {
+        BeginSinkValue("Value");
+        writer_->Value(value);
+        EndSinkValue();
+        return *this;
+    }
     //Кидаем исключение, если метод вызван вне конструктора или последний элемент не null и не массив
     if (!IsValue()) {
         throw std::logic_error("Value method call error");
@@ -34,6 +68,12 @@ Builder &Builder::Value(Node value) {
 }
 
 DictItemContext Builder::StartDict() {
+    if (writer_) {
+        BeginSinkValue("StartDict");
+        writer_->StartDict();
+        scopes_.push_back(Scope::DICT);
+        return *this;
+    }
     if (!IsValue()) {
         throw std::logic_error("StartDict method call error");
     }
@@ -48,6 +88,12 @@ DictItemContext Builder::StartDict() {
 }
 
 ArrayItemContext Builder::StartArray() {
+    if (writer_) {
+        BeginSinkValue("StartArray");
+        writer_->StartArray();
+        scopes_.push_back(Scope::ARRAY);
+        return *this;
+    }
     if (!IsValue()) {
         throw std::logic_error("StartArray method call error");
     }
@@ -61,6 +107,15 @@ ArrayItemContext Builder::StartArray() {
 }
 
 Builder &Builder::EndDict() {
+    if (writer_) {
+        if (scopes_.empty() || scopes_.back() != Scope::DICT) {
+            throw std::logic_error("Calling EndDict method outside a dictionary");
+        }
+        writer_->EndDict();
+        scopes_.pop_back();
+        EndSinkValue();
+        return *this;
+    }
     if (!IsMap()) {
         throw std::logic_error("Calling EndDict method outside a dictionary");
     }
@@ -69,6 +124,15 @@ Builder &Builder::EndDict() {
 }
 
 Builder &Builder::EndArray() {
+    if (writer_) {
+        if (scopes_.empty() || scopes_.back() != Scope::ARRAY) {
+            throw std::logic_error("Calling EndArray method outside an array");
+        }
+        writer_->EndArray();
+        scopes_.pop_back();
+        EndSinkValue();
+        return *this;
+    }
     if (!IsArray()) {
         throw std::logic_error("Calling EndArray method outside an array");
     }
@@ -77,12 +141,25 @@ Builder &Builder::EndArray() {
 }
 
 Node Builder::Build() {
+    if (writer_) {
+        throw std::logic_error("Builder writes to a sink, use Finish");
+    }
     if (!nodes_stack_.empty()) {
         throw std::logic_error("Object is not ready to build");
     }
     return root_;
 }
 
+void Builder::Finish() {
+    if (!writer_) {
+        throw std::logic_error("Builder has no sink, use Build");
+    }
+    if (!is_done_) {
+        throw std::logic_error("Object is not ready to build");
+    }
+    writer_->Flush();
+}
+
 bool Builder::IsMap() {
     return !nodes_stack_.empty() && nodes_stack_.back()->IsMap();
 }
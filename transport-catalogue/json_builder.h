@@ -1,3 +1,5 @@
+#pragma once
+
 #include "json.h"
 
 namespace json{
@@ -8,9 +10,13 @@ namespace json{
     class ArrayItemContext;
     class ArrayValueContext;
 
+    // Строит JSON через цепочку вызовов с проверкой контекста на этапе компиляции.
+    // По умолчанию собирает дерево Node (Build). Если передан Writer, значения сразу выводятся в него
+    // и память не зависит от размера документа; тогда вместо Build вызывается Finish
     class Builder{
     public:
         Builder();
+        explicit Builder(Writer& writer);
         KeyItemContext Key(std::string key);
         Builder& Value(Node value);
         DictItemContext StartDict();
@@ -18,10 +24,25 @@ namespace json{
         Builder& EndDict();
         Builder& EndArray();
         Node Build();
+        //Проверяет, что документ закончен, и передаёт вывод из Writer в поток
+        void Finish();
 
     private:
+        //Открытые контейнеры при выводе в Writer
+        enum class Scope {
+            DICT,       // словарь, ожидается ключ или конец
+            DICT_VALUE, // после ключа, ожидается значение
+            ARRAY,
+        };
+
         Node root_;
         std::vector<Node*> nodes_stack_;
+        Writer* writer_ = nullptr;
+        std::vector<Scope> scopes_;
+        bool is_done_ = false;
+
+        void BeginSinkValue(const char* method);
+        void EndSinkValue();
 
         bool IsMap();
         bool IsValue();
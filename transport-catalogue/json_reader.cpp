@@ -1,68 +1,256 @@
 #include "json_reader.h"
-#include "json_builder.h"
-#include <sstream>
 
 namespace json_reader {
 
-    JsonReader::JsonReader(const json::Document& document){
-        if(!document.GetRoot().IsMap()){
-            throw std::invalid_argument("Incorrect JSON");
+    JsonReader::JsonReader(json::Cursor& cursor, transport_catalogue::TransportCatalogue& catalogue){
+        bool has_render_settings = false;
+        bool has_routing_settings = false;
+        cursor.BeginObject();
+        std::string_view key;
+        while(cursor.NextKey(key)){
+            if(key == "base_requests"){
+                CursorBaseReader(cursor, catalogue);
+            }
+            else if(key == "stat_requests"){
+                CursorStatReader(cursor);
+            }
+            else if(key == "render_settings"){
+                JsonRenderSettingsReader(cursor.ReadValue().AsMap());
+                has_render_settings = true;
+            }
+            else if(key == "routing_settings"){
+                JsonRouterSettingsReader(cursor.ReadValue().AsMap());
+                has_routing_settings = true;
+            }
+            else{
+                cursor.Skip();
+            }
         }
-        const auto& query_map = document.GetRoot().AsMap();
-        if(!query_map.count("base_requests") || !query_map.count("stat_requests")
-            || !query_map.count("render_settings") || !query_map.count("routing_settings")){
+        cursor.Finish();
+        if(!has_render_settings || !has_routing_settings){
             throw std::invalid_argument("Incorrect JSON");
         }
-        JsonBaseReader(query_map.at("base_requests").AsArray());
-        JsonStatReader(query_map.at("stat_requests").AsArray());
-        JsonRenderSettingsReader(query_map.at("render_settings").AsMap());
-        JsonRouterSettingsReader(query_map.at("routing_settings").AsMap());
     }
 
-    const std::deque<std::string>& JsonReader::BaseRequestsReturn(){
-        return base_request_;
-    }
-    const std::vector<std::pair<int, std::string>>& JsonReader::StatRequestsReturn(){
-        return stat_request_;
+    void JsonReader::ReadBaseRequests(json::Cursor& cursor, transport_catalogue::TransportCatalogue& catalogue){
+        bool has_base_requests = false;
+        cursor.BeginObject();
+        std::string_view key;
+        while(cursor.NextKey(key)){
+            if(key == "base_requests"){
+                CursorBaseReader(cursor, catalogue);
+                has_base_requests = true;
+            }
+            else{
+                cursor.Skip();
+            }
+        }
+        cursor.Finish();
+        if(!has_base_requests){
+            throw std::invalid_argument("Incorrect JSON: no base requests");
+        }
     }
 
-    const RendererSettings& JsonReader::RenderSettingsReturn(){
-        return render_settings_;
+    void JsonReader::CursorBaseReader(json::Cursor& cursor, transport_catalogue::TransportCatalogue& catalogue){
+        CatalogueLoader loader(catalogue);
+        cursor.BeginArray();
+        while(cursor.NextElement()){
+            ReadBaseRequest(cursor, loader);
+        }
+        loader.Finish();
     }
 
-    void JsonReader::JsonBaseReader(const json::Array& base){
-        for(const auto& query : base){
-            if(!query.IsMap()){
-                throw std::invalid_argument("Incorrect base requests");
+    void JsonReader::ReadBaseRequest(json::Cursor& cursor, CatalogueLoader& loader){
+        if(cursor.Peek() != json::Cursor::Type::OBJECT){
+            throw std::invalid_argument("Incorrect base requests");
+        }
+        //Ключи могут идти в любом порядке, поэтому тип известен только в конце объекта
+        std::optional<std::string> type;
+        std::optional<std::string> name;
+        std::optional<double> latitude;
+        std::optional<double> longitude;
+        std::vector<std::pair<std::string, uint32_t>> distances;
+        std::optional<std::vector<std::string>> stops;
+        std::optional<bool> is_roundtrip;
+        cursor.BeginObject();
+        std::string_view key;
+        while(cursor.NextKey(key)){
+            if(key == "type"){
+                type = cursor.ReadString();
+            }
+            else if(key == "name"){
+                name = cursor.ReadString();
+            }
+            else if(key == "latitude"){
+                latitude = cursor.ReadDouble();
+            }
+            else if(key == "longitude"){
+                longitude = cursor.ReadDouble();
+            }
+            else if(key == "road_distances"){
+                cursor.BeginObject();
+                std::string_view to;
+                while(cursor.NextKey(to)){
+                    std::string to_name(to);
+                    distances.emplace_back(std::move(to_name), cursor.ReadInt());
+                }
+            }
+            else if(key == "stops"){
+                stops.emplace();
+                cursor.BeginArray();
+                while(cursor.NextElement()){
+                    stops->emplace_back(cursor.ReadString());
+                }
+            }
+            else if(key == "is_roundtrip"){
+                is_roundtrip = cursor.ReadBool();
+            }
+            else{
+                cursor.Skip();
+            }
+        }
+        //Обязательные поля: без них запрос не принимается
+        if(type == "Stop"){
+            if(!name || !latitude || !longitude){
+                throw std::invalid_argument("Incorrect JSON: stop needs name, latitude and longitude");
             }
-            if(query.AsMap().at("type").AsString() == "Stop"){
-                base_request_.push_front(JsonStopToString(query.AsMap()));
+            loader.AddStop(*name, {*latitude, *longitude});
+            for(const auto& [to, distance] : distances){
+                loader.AddDistance(*name, to, distance);
             }
-            if(query.AsMap().at("type").AsString() == "Bus"){
-                base_request_.push_back(JsonBusToString(query.AsMap()));
+        }
+        else if(type == "Bus"){
+            if(!name || !stops || !is_roundtrip){
+                throw std::invalid_argument("Incorrect JSON: bus needs name, stops and is_roundtrip");
+            }
+            loader.AddBus(*name, std::move(*stops), *is_roundtrip);
+        }
+        else{
+            throw std::invalid_argument("Incorrect base requests: type must be Stop or Bus");
+        }
+    }
+
+    void JsonReader::CursorStatReader(json::Cursor& cursor){
+        cursor.BeginArray();
+        while(cursor.NextElement()){
+            if(auto request = ReadStatRequest(cursor)){
+                stat_request_.push_back(std::move(*request));
             }
         }
     }
 
-    void JsonReader::JsonStatReader(const json::Array& stat){
-        for(const auto& query : stat){
-            if(!query.IsMap() || !query.AsMap().count("type") || !query.AsMap().count("id")){
-                throw std::invalid_argument("Incorrect stat requests");
+    std::optional<StatRequest> JsonReader::ReadStatRequest(json::Cursor& cursor,
+                                                           const transport_catalogue::TransportCatalogue* catalogue) const{
+        if(cursor.Peek() != json::Cursor::Type::OBJECT){
+            throw std::invalid_argument("Incorrect stat requests");
+        }
+        std::optional<int> id;
+        std::optional<std::string> type;
+        std::optional<std::string> name;
+        std::optional<std::string> from;
+        std::optional<std::string> to;
+        std::optional<int> z;
+        std::optional<int> x;
+        std::optional<int> y;
+        cursor.BeginObject();
+        std::string_view key;
+        while(cursor.NextKey(key)){
+            if(key == "id"){
+                id = cursor.ReadInt();
+            }
+            else if(key == "type"){
+                type = cursor.ReadString();
+            }
+            else if(key == "name"){
+                name = cursor.ReadString();
+            }
+            else if(key == "from"){
+                from = cursor.ReadString();
+            }
+            else if(key == "to"){
+                to = cursor.ReadString();
+            }
+            else if(key == "z"){
+                z = cursor.ReadInt();
             }
-            std::string request;
-            request += query.AsMap().at("type").AsString();
-            if(query.AsMap().count("name")) {
-                request += ' ';
-                request += query.AsMap().at("name").AsString();
+            else if(key == "x"){
+                x = cursor.ReadInt();
             }
-            if(query.AsMap().count("from") && query.AsMap().count("to")){
-                request += ' ';
-                request += query.AsMap().at("from").AsString();
-                request += " -> ";
-                request += query.AsMap().at("to").AsString();
+            else if(key == "y"){
+                y = cursor.ReadInt();
             }
-            stat_request_.push_back({query.AsMap().at("id").AsInt(), request});
+            else{
+                cursor.Skip();
             }
+        }
+        if(!id || !type){
+            throw std::invalid_argument("Incorrect stat requests");
+        }
+        StatRequest request;
+        request.id = *id;
+        if((*type == "Bus" || *type == "Stop") && !name){
+            throw std::invalid_argument("Incorrect stat requests: no name");
+        }
+        if(*type == "Bus"){
+            request.query = BusQuery{std::move(*name)};
+        }
+        else if(*type == "Stop"){
+            request.query = StopQuery{std::move(*name)};
+        }
+        else if(*type == "Route"){
+            if(!from || !to){
+                throw std::invalid_argument("Incorrect stat requests: no route ends");
+            }
+            request.query = RouteQuery{std::move(*from), std::move(*to)};
+        }
+        else if(*type == "RouteMap"){
+            if(!from || !to){
+                throw std::invalid_argument("Incorrect stat requests: no route ends");
+            }
+            request.query = RouteMapQuery{RouteQuery{std::move(*from), std::move(*to)}};
+        }
+        else if(*type == "Map"){
+            request.query = MapQuery{};
+        }
+        else if(*type == "Tile"){
+            if(!z || !x || !y){
+                throw std::invalid_argument("Incorrect stat requests: no tile coordinates");
+            }
+            request.query = MakeTileQuery(*z, *x, *y);
+        }
+        else{
+            return std::nullopt;
+        }
+        if(catalogue){
+            catalogue->Resolve(request);
+        }
+        return request;
+    }
+
+    const std::vector<StatRequest>& JsonReader::StatRequestsReturn(){
+        return stat_request_;
+    }
+
+    const RendererSettings& JsonReader::RenderSettingsReturn() const {
+        return render_settings_;
+    }
+
+    void JsonReader::ResolveStatRequests(const transport_catalogue::TransportCatalogue& catalogue){
+        for(auto& request : stat_request_){
+            catalogue.Resolve(request);
+        }
+    }
+
+    TileQuery JsonReader::MakeTileQuery(int z, int x, int y){
+        if(z < 0 || z > MAX_TILE_ZOOM){
+            throw std::invalid_argument("Incorrect stat requests: tile zoom must be in [0, " + std::to_string(MAX_TILE_ZOOM) + "]");
+        }
+        //Тайл вне карты не рисуется и не вытесняет из кэша настоящие тайлы
+        const int64_t tiles_per_side = int64_t{1} << z;
+        if(x < 0 || x >= tiles_per_side || y < 0 || y >= tiles_per_side){
+            throw std::invalid_argument("Incorrect stat requests: tile x and y must be in [0, " + std::to_string(tiles_per_side) + ")");
+        }
+        return TileQuery{z, x, y};
     }
 
     void JsonReader::JsonRenderSettingsReader(const json::Dict& settings){
@@ -82,6 +270,21 @@ namespace json_reader {
         for(const auto& color : settings.at("color_palette").AsArray()){
             render_settings_.color_palette.push_back(ReadColor(color));
         }
+        if(const auto it = settings.find("compact_svg"); it != settings.end()){
+            render_settings_.svg_output.compact = it->second.AsBool();
+        }
+        if(const auto it = settings.find("svg_precision"); it != settings.end()){
+            render_settings_.svg_output.precision = it->second.AsInt();
+            if(render_settings_.svg_output.precision < 0 || render_settings_.svg_output.precision > svg::MAX_PRECISION){
+                throw std::invalid_argument("svg_precision must be in [0, 9]");
+            }
+        }
+        if(const auto it = settings.find("simplify_tolerance"); it != settings.end()){
+            render_settings_.simplify_tolerance = it->second.AsDouble();
+            if(!(render_settings_.simplify_tolerance >= 0.0)){
+                throw std::invalid_argument("simplify_tolerance must be non-negative");
+            }
+        }
     }
 
     svg::Color JsonReader::ReadColor(const json::Node& node){
@@ -110,128 +313,7 @@ namespace json_reader {
         throw std::invalid_argument("Can't read color from JSON");
     }
 
-    std::string JsonReader::JsonStopToString(const json::Dict& json_stop){
-        std::stringstream result;
-        result.precision(15);
-        if(json_stop.at("type").AsString() == "Stop") {
-            result << json_stop.at("type").AsString();
-            result << ' ';
-            result << json_stop.at("name").AsString();
-            result << ": ";
-            result << json_stop.at("latitude").AsDouble();
-            result << ", ";
-            result << json_stop.at("longitude").AsDouble();
-            if(!json_stop.at("road_distances").AsMap().empty()) {
-                result << ", ";
-                bool is_first = true;
-                for (const auto &next_stop: json_stop.at("road_distances").AsMap()) {
-                    if(!is_first){
-                        result << ", ";
-                    }
-                    result << next_stop.second.AsInt();
-                    result << "m to ";
-                    result << next_stop.first;
-                    is_first = false;
-                }
-            }
-        }
-        else{
-            throw std::invalid_argument("Incorrect JSON: not a stop description");
-        }
-        return result.str();
-    }
-
-    std::string JsonReader::JsonBusToString(const json::Dict& json_bus){
-        std::string result;
-        if(json_bus.at("type").AsString() == "Bus") {
-            result += json_bus.at("type").AsString();
-            result += ' ';
-            result += json_bus.at("name").AsString();
-            result += ": ";
-            bool is_circle = json_bus.at("is_roundtrip").AsBool();
-            bool is_first = true;
-            std::string separator = is_circle ? " > " : " - ";
-            for(const auto& stop : json_bus.at("stops").AsArray()){
-                if(!is_first){
-                    result += separator;
-                }
-                result += stop.AsString();
-                is_first = false;
-            }
-        }
-        else{
-            throw std::invalid_argument("Incorrect JSON: not a bus description");
-        }
-        return result;
-    }
-
-    json::Document JsonReader::MakeJSON(const std::vector<std::pair<int, std::variant<BusRoute, StopRoutes, svg::Document, BusTripRoute>>>& answers) {
-        using namespace std::string_literals;
-        json::Builder builder;
-        builder.StartArray();
-        for (const auto &answer: answers) {
-            builder.StartDict().Key("request_id"s).Value(answer.first);
-            if (std::holds_alternative<BusRoute>(answer.second)) {
-                const auto &bus = std::get<BusRoute>(answer.second);
-                if (bus.is_found) {
-                    builder.Key("curvature"s).Value(bus.curvature)
-                            .Key("route_length"s).Value(bus.true_length)
-                            .Key("stop_count"s).Value(static_cast<int>(bus.stops))
-                            .Key("unique_stop_count"s).Value(static_cast<int>(bus.unique_stops)).EndDict();
-                } else {
-                    builder.Key("error_message"s).Value("not found"s).EndDict();
-                }
-            }
-            if (std::holds_alternative<StopRoutes>(answer.second)) {
-                const auto &stop = std::get<StopRoutes>(answer.second);
-                if (stop.is_found) {
-                    builder.Key("buses"s).StartArray();
-                    for (const auto &bus: stop.routes) {
-                        std::string bus_str = {bus.data(), bus.size()};
-                        builder.Value(bus_str);
-                    }
-                    builder.EndArray().EndDict();
-                } else {
-                    builder.Key("error_message"s).Value("not found"s).EndDict();
-                }
-            }
-            if (std::holds_alternative<svg::Document>(answer.second)) {
-                const auto &svg_doc = std::get<svg::Document>(answer.second);
-                std::stringstream svg_str;
-                svg_doc.Render(svg_str);
-                builder.Key("map"s).Value(svg_str.str()).EndDict();
-            }
-            if (std::holds_alternative<BusTripRoute>(answer.second)){
-                const auto &bus_trip_route = std::get<BusTripRoute>(answer.second);
-                if(bus_trip_route.is_found) {
-                    builder.Key("total_time"s).Value(bus_trip_route.total_time_).Key("items"s).StartArray();
-                    if(!bus_trip_route.stages_.empty()) {
-                        for (const auto &stage: bus_trip_route.stages_) {
-                            builder.StartDict().Key("type"s).Value("Wait"s).Key("stop_name"s).Value(
-                                            std::string(stage.stops_.first))
-                                    .Key("time"s).Value(router_settings_.bus_wait_time_).EndDict();
-                            builder.StartDict().Key("type"s).Value("Bus"s).Key("bus"s).Value(
-                                            std::string(stage.bus_name_))
-                                    .Key("span_count"s).Value(static_cast<int>(stage.span_count_))
-                                    .Key("time"s).Value(stage.time_ - router_settings_.bus_wait_time_).EndDict();
-                        }
-                        builder.EndArray();
-                    }
-                    else{
-                        builder.EndArray();
-                    }
-                    builder.EndDict();
-                }
-                else{
-                    builder.Key("error_message"s).Value("not found"s).EndDict();
-                }
-            }
-        }
-                builder.EndArray();
-        return json::Document(builder.Build());
-    }
-
-    const RouterSettings &JsonReader::RouterSettingsReturn() {
+    const RouterSettings &JsonReader::RouterSettingsReturn() const {
         return router_settings_;
     }
 
@@ -239,4 +321,37 @@ namespace json_reader {
         router_settings_.bus_wait_time_ = settings.at("bus_wait_time").AsInt();
         router_settings_.bus_velocity_ = settings.at("bus_velocity").AsDouble();
     }
-}//namespace json_reader
\ No newline at end of file
+
+    //-----------------Методы класса CatalogueLoader-----------------
+
+    CatalogueLoader::CatalogueLoader(transport_catalogue::TransportCatalogue& catalogue)
+            : catalogue_(catalogue){
+    }
+
+    void CatalogueLoader::AddStop(std::string_view name, geo::Coordinates coordinates){
+        catalogue_.AddStop(name, coordinates);
+    }
+
+    void CatalogueLoader::AddDistance(std::string_view from, std::string_view to, uint32_t distance){
+        pending_distances_.push_back({std::string(from), std::string(to), distance});
+    }
+
+    void CatalogueLoader::AddBus(std::string_view name, std::vector<std::string> stops, bool is_circle){
+        pending_buses_.push_back({std::string(name), std::move(stops), is_circle});
+    }
+
+    void CatalogueLoader::Finish(){
+        for(const auto& [from, to, distance] : pending_distances_){
+            catalogue_.SetDistance(from, to, distance);
+        }
+        std::vector<std::string_view> stops;
+        for(const auto& bus : pending_buses_){
+            stops.assign(bus.stops.begin(), bus.stops.end());
+            catalogue_.AddBus(bus.name, stops, bus.is_circle);
+        }
+        pending_distances_.clear();
+        pending_distances_.shrink_to_fit();
+        pending_buses_.clear();
+        pending_buses_.shrink_to_fit();
+    }
+}//namespace json_reader
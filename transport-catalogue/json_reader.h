@@ -3,38 +3,77 @@
 #include "json.h"
 #include "domain.h"
 #include "map_renderer.h"
+#include "map_tiles.h"
 #include "transport_router.h"
-#include <deque>
+#include <optional>
 #include <unordered_map>
 
 namespace json_reader {
+
+    // Добавляет элементы base_requests в справочник по мере чтения. Остановки добавляются сразу,
+    // расстояния и маршруты могут ссылаться на остановки, описанные позже, поэтому откладываются до Finish
+    class CatalogueLoader {
+    public:
+        explicit CatalogueLoader(transport_catalogue::TransportCatalogue& catalogue);
+
+        void AddStop(std::string_view name, geo::Coordinates coordinates);
+        void AddDistance(std::string_view from, std::string_view to, uint32_t distance);
+        void AddBus(std::string_view name, std::vector<std::string> stops, bool is_circle);
+        //Добавляет отложенные расстояния и маршруты
+        void Finish();
+
+    private:
+        struct PendingBus {
+            std::string name;
+            std::vector<std::string> stops;
+            bool is_circle = false;
+        };
+        struct PendingDistance {
+            std::string from;
+            std::string to;
+            uint32_t distance = 0;
+        };
+
+        transport_catalogue::TransportCatalogue& catalogue_;
+        std::vector<PendingDistance> pending_distances_;
+        std::vector<PendingBus> pending_buses_;
+    };
+
     class JsonReader {
     public:
         JsonReader() = default;
-        explicit JsonReader(const json::Document& document);
+        //Читает документ курсором без построения дерева: base_requests сразу добавляются в catalogue,
+        //stat_requests — в очередь запросов
+        JsonReader(json::Cursor& cursor, transport_catalogue::TransportCatalogue& catalogue);
+
+        //Читает base_requests из отдельного документа курсором прямо в catalogue, остальное пропускает
+        void ReadBaseRequests(json::Cursor& cursor, transport_catalogue::TransportCatalogue& catalogue);
 
-        const std::deque<std::string>& BaseRequestsReturn();
-        const std::vector<std::pair<int, std::string>>& StatRequestsReturn();
+        const std::vector<StatRequest>& StatRequestsReturn();
+        //Разрешает названия в прочитанных stat_requests по справочнику
+        void ResolveStatRequests(const transport_catalogue::TransportCatalogue& catalogue);
 
-        const RendererSettings& RenderSettingsReturn();
-        const RouterSettings& RouterSettingsReturn();
+        const RendererSettings& RenderSettingsReturn() const;
+        const RouterSettings& RouterSettingsReturn() const;
 
-        json::Document MakeJSON(const std::vector<std::pair<int, std::variant<BusRoute, StopRoutes, svg::Document, BusTripRoute>>>& answers);
+        //Разбор отдельных элементов документа для потоковой обработки и построчных запросов
+        //Элемент base_requests; запрос без типа или неизвестного типа не принимается
+        static void ReadBaseRequest(json::Cursor& cursor, CatalogueLoader& loader);
+        //Элемент stat_requests. Запрос неизвестного типа пропускается (std::nullopt). Если передан справочник, названия сразу разрешаются
+        std::optional<StatRequest> ReadStatRequest(json::Cursor& cursor,
+                                                   const transport_catalogue::TransportCatalogue* catalogue = nullptr) const;
+        void JsonRenderSettingsReader(const json::Dict & settings);
+        void JsonRouterSettingsReader(const json::Dict& settings);
 
     private:
-        std::deque<std::string> base_request_;
-        std::vector<std::pair<int, std::string>> stat_request_;
+        std::vector<StatRequest> stat_request_;
         RendererSettings render_settings_;
         RouterSettings router_settings_;
 
-        void JsonBaseReader(const json::Array& base);
-        void JsonStatReader(const json::Array& stat);
-        void JsonRenderSettingsReader(const json::Dict & settings);
-        void JsonRouterSettingsReader(const json::Dict& settings);
+        void CursorBaseReader(json::Cursor& cursor, transport_catalogue::TransportCatalogue& catalogue);
+        void CursorStatReader(json::Cursor& cursor);
 
         svg::Color ReadColor(const json::Node& node);
-
-        std::string JsonStopToString(const json::Dict& json_stop);
-        std::string JsonBusToString(const json::Dict& json_bus);
+        static TileQuery MakeTileQuery(int z, int x, int y);
     };
 }//namespace json_reader
\ No newline at end of file
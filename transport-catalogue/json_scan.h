@@ -0,0 +1,148 @@
+#pragma once
+
+#include "json.h"
+
+#include <string>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Общие примитивы разбора JSON из непрерывного буфера: используются json::Load и json::arena
+namespace json::detail {
+
+    // Наибольшая вложенность массивов и объектов. Разбор рекурсивный, поэтому более глубокий документ
+    // отклоняется с ParsingError, а не переполняет стек (например, строка из сотен тысяч '[')
+    inline constexpr size_t MAX_DEPTH = 512;
+
+    // Учитывает вложенность на время разбора одного массива или объекта.
+    // pos — начало значения, его смещение от document попадает в ошибку
+    class DepthGuard {
+    public:
+        DepthGuard(size_t& depth, const char* document, const char* pos)
+                : depth_(depth) {
+            if (depth_ >= MAX_DEPTH) {
+                throw ParsingError("Document is nested too deeply", static_cast<size_t>(pos - document));
+            }
+            ++depth_;
+        }
+
+        DepthGuard(const DepthGuard&) = delete;
+        DepthGuard& operator=(const DepthGuard&) = delete;
+
+        ~DepthGuard() {
+            --depth_;
+        }
+
+    private:
+        size_t& depth_;
+    };
+
+    inline bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    // Пропускает пробельные символы, возвращает первый непробельный или end
+    inline const char* SkipSpaces(const char* it, const char* end) {
+#ifdef __SSE2__
+        //Короткие промежутки (один пробел после ':' или ',') дешевле пропустить побайтно
+        if (it != end && !IsSpace(*it)) {
+            return it;
+        }
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i carriage = _mm_set1_epi8('\r');
+        const __m128i tab = _mm_set1_epi8('\t');
+        while (end - it >= 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+            const __m128i is_space = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, newline)),
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, carriage), _mm_cmpeq_epi8(chunk, tab)));
+            const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(is_space)) & 0xFFFFu;
+            if (mask != 0) {
+                return it + __builtin_ctz(mask);
+            }
+            it += 16;
+        }
+#endif
+        while (it != end && IsSpace(*it)) {
+            ++it;
+        }
+        return it;
+    }
+
+    // Пропускает обычные символы строки до первой кавычки или обратной косой черты
+    inline const char* FindStringSpecial(const char* it, const char* end) {
+#ifdef __SSE2__
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while (end - it >= 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+            const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash))));
+            if (mask != 0) {
+                return it + __builtin_ctz(mask);
+            }
+            it += 16;
+        }
+#endif
+        while (it != end && *it != '"' && *it != '\\') {
+            ++it;
+        }
+        return it;
+    }
+
+    // Символ, обозначаемый escape-последовательностью \c. false для неподдерживаемых последовательностей
+    inline bool Unescape(char c, char& result) {
+        switch (c) {
+            case 'n': result = '\n'; return true;
+            case 'r': result = '\r'; return true;
+            case 't': result = '\t'; return true;
+            case '"': [[fallthrough]];
+            case '\\': result = c; return true;
+            default: return false;
+        }
+    }
+
+    inline bool IsDigit(const char* it, const char* end) {
+        return it != end && *it >= '0' && *it <= '9';
+    }
+
+    // Проверяет грамматику числа JSON, начинающегося с it. Возвращает конец числа,
+    // is_int — нет ли дробной части и экспоненты. document — начало текста для смещения в ошибке
+    inline const char* ScanNumber(const char* document, const char* it, const char* end, bool& is_int) {
+        auto skip_digits = [document, end](const char* digit) {
+            if (!IsDigit(digit, end)) {
+                throw ParsingError("A digit is expected", static_cast<size_t>(digit - document));
+            }
+            while (IsDigit(digit, end)) {
+                ++digit;
+            }
+            return digit;
+        };
+
+        is_int = true;
+        if (it != end && *it == '-') {
+            ++it;
+        }
+        if (it != end && *it == '0') {
+            ++it;
+        } else {
+            it = skip_digits(it);
+        }
+        if (it != end && *it == '.') {
+            it = skip_digits(it + 1);
+            is_int = false;
+        }
+        if (it != end && (*it == 'e' || *it == 'E')) {
+            ++it;
+            if (it != end && (*it == '+' || *it == '-')) {
+                ++it;
+            }
+            it = skip_digits(it);
+            is_int = false;
+        }
+        return it;
+    }
+
+}//namespace json::detail
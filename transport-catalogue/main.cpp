@@ -1,12 +1,252 @@
 #include "request_handler.h"
+#include "answer_writer.h"
+#include "catalogue_snapshot.h"
+#include "json_builder.h"
+#include "profile.h"
+#include "server.h"
+#include "stream_pipeline.h"
 
-int main(){
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+namespace {
     using namespace transport_catalogue;
-    json_reader::JsonReader json_input(json::Load(std::cin));
-    TransportCatalogue t(json_input.BaseRequestsReturn());
-    TransportRouter tr(t, json_input.RouterSettingsReturn());
-    request_handler::RequestHandler answers(t, json_input.StatRequestsReturn(), json_input.RenderSettingsReturn(), tr);
-    auto answers_map = json_input.MakeJSON(answers.GetAnswers());
-    Print(answers_map, std::cout);
+
+    struct Options {
+        std::string base_path;      // --base: base_requests в отдельном файле
+        std::string snapshot_path;  // --snapshot: бинарный снимок справочника для --base
+        bool memory_report = false; // --memory-report: вывести оценку занимаемой памяти в stderr
+        size_t threads = parallel::DefaultThreadCount(); // --threads: число потоков обработки запросов
+        bool stream = false;        // --stream: потоковая обработка входа
+        bool serve = false;         // --serve: долгоживущий режим с построчными запросами
+        std::string socket_path;    // --socket: в режиме --serve принимать клиентов на Unix-сокете вместо stdin
+        std::string export_path;    // --export-tiles: записать векторные тайлы карты в каталог вместо ответов
+        int max_zoom = 4;           // --max-zoom: наибольший уровень экспортируемых тайлов
+        bool profile = false;       // --profile: вывести время фаз и счётчики в stderr
+    };
+
+    Options ParseOptions(int argc, char* argv[]) {
+        using namespace std::string_view_literals;
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (arg == "--base"sv && i + 1 < argc) {
+                options.base_path = argv[++i];
+            } else if (arg == "--snapshot"sv && i + 1 < argc) {
+                options.snapshot_path = argv[++i];
+            } else if (arg == "--threads"sv && i + 1 < argc) {
+                options.threads = std::stoul(argv[++i]);
+                if (options.threads == 0) {
+                    throw std::invalid_argument("--threads must be positive");
+                }
+            } else if (arg == "--stream"sv) {
+                options.stream = true;
+            } else if (arg == "--serve"sv) {
+                options.serve = true;
+            } else if (arg == "--socket"sv && i + 1 < argc) {
+                options.socket_path = argv[++i];
+            } else if (arg == "--export-tiles"sv && i + 1 < argc) {
+                options.export_path = argv[++i];
+            } else if (arg == "--max-zoom"sv && i + 1 < argc) {
+                options.max_zoom = std::stoi(argv[++i]);
+                if (options.max_zoom < 0 || options.max_zoom > MAX_TILE_ZOOM) {
+                    throw std::invalid_argument("--max-zoom must be in [0, " + std::to_string(MAX_TILE_ZOOM) + "]");
+                }
+            } else if (arg == "--memory-report"sv) {
+                options.memory_report = true;
+            } else if (arg == "--profile"sv) {
+                options.profile = true;
+            } else {
+                throw std::invalid_argument("Unknown argument: " + std::string(arg));
+            }
+        }
+        if (!options.snapshot_path.empty() && options.base_path.empty()) {
+            throw std::invalid_argument("--snapshot requires --base");
+        }
+        if (options.stream && (!options.base_path.empty() || options.memory_report)) {
+            throw std::invalid_argument("--stream can't be combined with --base or --memory-report");
+        }
+        if (options.serve && options.base_path.empty()) {
+            throw std::invalid_argument("--serve requires --base");
+        }
+        if (!options.socket_path.empty() && !options.serve) {
+            throw std::invalid_argument("--socket requires --serve");
+        }
+        if (!options.export_path.empty() && (options.stream || options.serve)) {
+            throw std::invalid_argument("--export-tiles can't be combined with --stream or --serve");
+        }
+        return options;
+    }
+
+    //Загружает справочник из снимка, если он построен по тому же файлу базы, иначе разбирает JSON и обновляет снимок
+    TransportCatalogue LoadBase(const Options& options, json_reader::JsonReader& json_input) {
+        std::ifstream base_file(options.base_path, std::ios::binary);
+        if (!base_file) {
+            throw std::invalid_argument("Can't open " + options.base_path);
+        }
+        const std::string base_text{std::istreambuf_iterator<char>(base_file), std::istreambuf_iterator<char>()};
+        const uint64_t source_hash = snapshot::ComputeSourceHash(base_text);
+
+        if (!options.snapshot_path.empty()) {
+            try {
+                snapshot::MappedSnapshot mapped(options.snapshot_path);
+                if (mapped.GetSourceHash() == source_hash) {
+                    TransportCatalogue catalogue;
+                    mapped.LoadInto(catalogue);
+                    return catalogue;
+                }
+            } catch (const snapshot::SnapshotError&) {
+                //Снимка нет или он испорчен — перестраиваем
+            }
+        }
+
+        TransportCatalogue catalogue;
+        json::Cursor cursor(base_text);
+        json_input.ReadBaseRequests(cursor, catalogue);
+        if (!options.snapshot_path.empty()) {
+            //Справочник уже построен: без снимка следующий запуск просто снова разберёт JSON
+            try {
+                snapshot::Save(catalogue, source_hash, options.snapshot_path);
+            } catch (const snapshot::SnapshotError& e) {
+                std::cerr << "Warning: " << e.what() << std::endl;
+            }
+        }
+        return catalogue;
+    }
+
+    //Пишет непустые векторные тайлы в каталог по схеме z/x/y.mvt
+    void ExportVectorTiles(const MapTiles& tiles, const Options& options) {
+        namespace fs = std::filesystem;
+        tiles.ForEachVectorTile(options.max_zoom, [&options](const TileQuery& tile, const std::string& data) {
+            const fs::path directory = fs::path(options.export_path) / std::to_string(tile.z) / std::to_string(tile.x);
+            fs::create_directories(directory);
+            const fs::path path = directory / (std::to_string(tile.y) + ".mvt");
+            std::ofstream out(path, std::ios::binary);
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!out) {
+                throw std::runtime_error("Can't write " + path.string());
+            }
+        });
+    }
+
+    json::Node SizeToNode(size_t size) {
+        if (size <= static_cast<size_t>(INT_MAX)) {
+            return static_cast<int>(size);
+        }
+        return static_cast<double>(size);
+    }
+
+    void AddUsage(json::Builder& builder, const std::string& name, const memory::Usage& usage) {
+        builder.Key(name).StartDict()
+                .Key("bytes").Value(SizeToNode(usage.bytes))
+                .Key("overhead").Value(SizeToNode(usage.overhead))
+                .Key("total").Value(SizeToNode(usage.Total()))
+                .EndDict();
+    }
+
+    //Печатает отчёт о памяти по компонентам в формате JSON
+    void PrintMemoryReport(const std::map<std::string, memory::Report>& components, std::ostream& out) {
+        json::Writer writer(out);
+        json::Builder builder(writer);
+        builder.StartDict();
+        memory::Usage total;
+        for (const auto& [component, report] : components) {
+            builder.Key(component).StartDict();
+            for (const auto& [name, usage] : report) {
+                AddUsage(builder, name, usage);
+            }
+            AddUsage(builder, "total", memory::Sum(report));
+            builder.EndDict();
+            total += memory::Sum(report);
+        }
+        AddUsage(builder, "total", total);
+        builder.EndDict().Finish();
+        out << std::endl;
+    }
+
+    //Пакетный режим: все фазы по порядку, с замером каждой для --profile
+    void RunBatch(const Options& options) {
+        static profile::Site read_phase("phase.read_input");
+        //Курсор добавляет base_requests в справочник по ходу разбора, поэтому разбор и загрузка — одна фаза
+        static profile::Site parse_phase("phase.parse_and_load_input");
+        static profile::Site base_phase("phase.load_base");
+        static profile::Site resolve_phase("phase.resolve_requests");
+        static profile::Site router_phase("phase.build_router");
+        static profile::Site export_phase("phase.export_tiles");
+        static profile::Site answer_phase("phase.answer_requests");
+
+        std::string input_text;
+        {
+            const profile::ScopedTimer timer(read_phase);
+            input_text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+        }
+        //Вход разбирается курсором: base_requests сразу попадают в справочник, дерево документа не строится
+        TransportCatalogue t;
+        json::Cursor cursor(input_text);
+        json_reader::JsonReader json_input = [&cursor, &t] {
+            const profile::ScopedTimer timer(parse_phase);
+            return json_reader::JsonReader(cursor, t);
+        }();
+        if (!options.base_path.empty()) {
+            const profile::ScopedTimer timer(base_phase);
+            t = LoadBase(options, json_input);
+        }
+        {
+            const profile::ScopedTimer timer(resolve_phase);
+            json_input.ResolveStatRequests(t);
+        }
+        if (!options.export_path.empty()) {
+            //Тайлам нужен только справочник: маршрутизатор с его предподсчётом не строится
+            const profile::ScopedTimer timer(export_phase);
+            ExportVectorTiles(MapTiles(json_input.RenderSettingsReturn(), t.GetActiveBuses()), options);
+            return;
+        }
+        const TransportRouter tr = [&t, &json_input] {
+            const profile::ScopedTimer timer(router_phase);
+            return TransportRouter(t, json_input.RouterSettingsReturn());
+        }();
+        request_handler::RequestHandler handler(t, json_input.RenderSettingsReturn(), tr, options.threads);
+        {
+            const profile::ScopedTimer timer(answer_phase);
+            json_reader::AnswerWriter writer(std::cout, json_input.RouterSettingsReturn());
+            handler.ProcessRequests(json_input.StatRequestsReturn(), options.threads,
+                                    [&writer](int id, const request_handler::RequestHandler::Answer& answer) {
+                                        writer.Write(id, answer);
+                                    });
+            writer.Finish();
+        }
+        if (options.memory_report) {
+            PrintMemoryReport({{"catalogue", t.MemoryUsage()},
+                               {"router", tr.MemoryUsage()},
+                               {"input", {{"text", memory::Heap(input_text)}}}}, std::cerr);
+        }
+    }
+}//namespace
+
+int main(int argc, char* argv[]){
+    const Options options = ParseOptions(argc, argv);
+    if (options.profile) {
+        profile::Enable();
+    }
+    if (options.stream) {
+        static profile::Site stream_phase("phase.stream");
+        const profile::ScopedTimer timer(stream_phase);
+        stream_pipeline::Run(std::cin, std::cout);
+    } else if (options.serve) {
+        server::Server server(options.base_path);
+        if (options.socket_path.empty()) {
+            server.Serve(std::cin, std::cout);
+        } else {
+            server.ServeUnixSocket(options.socket_path);
+        }
+    } else {
+        RunBatch(options);
+    }
+    if (options.profile) {
+        profile::PrintReport(std::cerr);
+    }
     return 0;
-}
\ No newline at end of file
+}
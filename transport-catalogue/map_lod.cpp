@@ -0,0 +1,150 @@
+#include "map_lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+namespace lod {
+
+    namespace {
+        double SquaredDistance(svg::Point a, svg::Point b) {
+            const double dx = a.x - b.x;
+            const double dy = a.y - b.y;
+            return dx * dx + dy * dy;
+        }
+
+        //Квадрат расстояния от точки p до отрезка ab
+        double SquaredSegmentDistance(svg::Point p, svg::Point a, svg::Point b) {
+            const double dx = b.x - a.x;
+            const double dy = b.y - a.y;
+            const double length = dx * dx + dy * dy;
+            if (length == 0.0) {
+                return SquaredDistance(p, a);
+            }
+            const double t = std::fmax(0.0, std::fmin(1.0, ((p.x - a.x) * dx + (p.y - a.y) * dy) / length));
+            return SquaredDistance(p, {a.x + t * dx, a.y + t * dy});
+        }
+
+        //Ячейка сетки не мельче 1/1024 пикселя холста: при крошечном допуске номера ячеек иначе переполняются.
+        //Крупная ячейка только добавляет кандидатов для проверки расстояния и на результат не влияет
+        constexpr double MIN_CELL_SIZE = 1.0 / 1024;
+
+        // Хеш-сетка с ячейкой не меньше допуска: соседи точки ищутся в ячейках 3 × 3 вокруг неё
+        class PointGrid {
+        public:
+            explicit PointGrid(double cell_size)
+                    : cell_size_(std::max(cell_size, MIN_CELL_SIZE)) {
+            }
+
+            bool HasNeighbour(svg::Point point, double squared_tolerance, const std::vector<svg::Point>& points) const {
+                const auto [cell_x, cell_y] = Cell(point);
+                for (int64_t x = cell_x - 1; x <= cell_x + 1; ++x) {
+                    for (int64_t y = cell_y - 1; y <= cell_y + 1; ++y) {
+                        const auto it = cells_.find(Key(x, y));
+                        if (it == cells_.end()) {
+                            continue;
+                        }
+                        for (const size_t index : it->second) {
+                            if (SquaredDistance(point, points[index]) < squared_tolerance) {
+                                return true;
+                            }
+                        }
+                    }
+                }
+                return false;
+            }
+
+            void Add(size_t index, svg::Point point) {
+                const auto [x, y] = Cell(point);
+                cells_[Key(x, y)].push_back(index);
+            }
+
+        private:
+            double cell_size_;
+            std::unordered_map<uint64_t, std::vector<size_t>> cells_;
+
+            //Номер ячейки ограничен 32 битами ключа, так что приведение к целому всегда определено
+            std::pair<int64_t, int64_t> Cell(svg::Point point) const {
+                return {CellIndex(point.x), CellIndex(point.y)};
+            }
+
+            int64_t CellIndex(double coordinate) const {
+                static constexpr double LIMIT = 1u << 31;
+                return static_cast<int64_t>(std::clamp(std::floor(coordinate / cell_size_), -LIMIT, LIMIT - 1));
+            }
+
+            static uint64_t Key(int64_t x, int64_t y) {
+                return (static_cast<uint64_t>(x) << 32) ^ static_cast<uint32_t>(y);
+            }
+        };
+    }//namespace
+
+    std::vector<svg::Point> Simplify(const std::vector<svg::Point>& points, double tolerance) {
+        if (points.size() <= 2 || !(tolerance > 0.0)) {
+            return points;
+        }
+        const double squared_tolerance = tolerance * tolerance;
+        std::vector<bool> keep(points.size(), false);
+        keep.front() = true;
+        keep.back() = true;
+        //Отрезки ломаной, ещё не проверенные на отклонение вершин; стек вместо рекурсии
+        std::vector<std::pair<size_t, size_t>> ranges{{0, points.size() - 1}};
+        while (!ranges.empty()) {
+            const auto [first, last] = ranges.back();
+            ranges.pop_back();
+            double max_distance = 0.0;
+            size_t farthest = first;
+            for (size_t i = first + 1; i < last; ++i) {
+                const double distance = SquaredSegmentDistance(points[i], points[first], points[last]);
+                if (distance > max_distance) {
+                    max_distance = distance;
+                    farthest = i;
+                }
+            }
+            if (max_distance > squared_tolerance) {
+                keep[farthest] = true;
+                ranges.emplace_back(first, farthest);
+                ranges.emplace_back(farthest, last);
+            }
+        }
+        std::vector<svg::Point> result;
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (keep[i]) {
+                result.push_back(points[i]);
+            }
+        }
+        return result;
+    }
+
+    std::vector<int> MinZoomLevels(const std::vector<svg::Point>& points, double tolerance, int max_zoom) {
+        std::vector<int> levels(points.size(), max_zoom + 1);
+        if (!(tolerance > 0.0)) {
+            std::fill(levels.begin(), levels.end(), 0);
+            return levels;
+        }
+        //Видимые на уровне z точки попарно дальше допуска уровня z, а значит и более мелкого допуска
+        //следующего уровня: они остаются видимыми, и сравнивать с ними нужно только оставшиеся
+        size_t hidden = points.size();
+        for (int zoom = 0; zoom <= max_zoom && hidden > 0; ++zoom) {
+            const double level_tolerance = std::ldexp(tolerance, -zoom);
+            const double squared_tolerance = level_tolerance * level_tolerance;
+            PointGrid grid(level_tolerance);
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (levels[i] < zoom) {
+                    grid.Add(i, points[i]);
+                }
+            }
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (levels[i] > zoom && !grid.HasNeighbour(points[i], squared_tolerance, points)) {
+                    levels[i] = zoom;
+                    grid.Add(i, points[i]);
+                    --hidden;
+                }
+            }
+        }
+        return levels;
+    }
+
+}//namespace lod
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "svg.h"
+
+#include <vector>
+
+// Упрощение карты для обзорных масштабов: точки, которые на холсте ближе допуска, неразличимы
+namespace lod {
+
+    // Ломаная, упрощённая алгоритмом Дугласа — Пекера: ни одна отброшенная вершина не отстоит
+    // от упрощённой ломаной дальше tolerance. Первая и последняя вершины сохраняются
+    std::vector<svg::Point> Simplify(const std::vector<svg::Point>& points, double tolerance);
+
+    // Прореживание остановок по уровням масштаба: на уровне z допуск равен tolerance / 2^z.
+    // Для каждой точки возвращает наименьший уровень, с которого она видна (max_zoom + 1 — не видна и на max_zoom).
+    // Точки перебираются по порядку, видимая точка скрывает более поздние в пределах допуска.
+    // Точка, видимая на уровне z, видна и на всех более крупных
+    std::vector<int> MinZoomLevels(const std::vector<svg::Point>& points, double tolerance, int max_zoom);
+
+}//namespace lod
@@ -1,25 +1,48 @@
 #include "map_renderer.h"
+#include "profile.h"
+
+namespace {
+    //Порции параллельной отрисовки: не меньше MIN_RENDER_CHUNK элементов, по несколько на поток
+    constexpr size_t MIN_RENDER_CHUNK = 256;
+    constexpr size_t RENDER_CHUNKS_PER_THREAD = 4;
+}//namespace
 
 bool IsZero(double value) {
     return std::abs(value) < EPSILON;
 }
 
-svg::Polyline MapRenderer::RenderRoute(std::shared_ptr<Bus>& bus, const svg::Color& color) {
-    svg::Polyline route;
-    route.SetFillColor(svg::NoneColor).SetStrokeColor(color).SetStrokeWidth(renderer_settings_.line_width).
-        SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-    for(auto it = bus->route.begin(); it != bus->route.end(); ++it){
-        route.AddPoint(canvas_({(*it)->latitude, (*it)->longitude}));
+bool operator==(const RendererSettings& lhs, const RendererSettings& rhs) {
+    return lhs.width == rhs.width && lhs.height == rhs.height && lhs.padding == rhs.padding
+           && lhs.line_width == rhs.line_width && lhs.stop_radius == rhs.stop_radius
+           && lhs.bus_label_font_size == rhs.bus_label_font_size && lhs.bus_label_offset == rhs.bus_label_offset
+           && lhs.stop_label_font_size == rhs.stop_label_font_size && lhs.stop_label_offset == rhs.stop_label_offset
+           && lhs.underlayer_color == rhs.underlayer_color && lhs.underlayer_width == rhs.underlayer_width
+           && lhs.color_palette == rhs.color_palette && lhs.svg_output == rhs.svg_output
+           && lhs.simplify_tolerance == rhs.simplify_tolerance;
+}
+
+std::vector<svg::Point> MapRenderer::RoutePoints(const Bus& bus) const {
+    std::vector<svg::Point> points;
+    points.reserve(bus.is_circle ? bus.route.size() : 2 * bus.route.size());
+    for(auto it = bus.route.begin(); it != bus.route.end(); ++it){
+        points.push_back(Project(**it));
     }
-    if(!bus->is_circle){
-        for(auto it = bus->route.rbegin() + 1; it != bus->route.rend(); ++it){
-            route.AddPoint(canvas_({(*it)->latitude, (*it)->longitude}));
+    if(!bus.is_circle && !bus.route.empty()){
+        for(auto it = bus.route.rbegin() + 1; it != bus.route.rend(); ++it){
+            points.push_back(Project(**it));
         }
     }
-    return route;
+    return points;
+}
+
+void MapRenderer::RenderRoute(svg::FlatDocument& doc, const Bus& bus, svg::StyleId style) const {
+    doc.StartPolyline(style);
+    for(const svg::Point point : lod::Simplify(RoutePoints(bus), renderer_settings_.simplify_tolerance)){
+        doc.AddPoint(point);
+    }
 }
 
-std::vector<geo::Coordinates> MapRenderer::GetStopsCoordinates(const std::map<std::string_view, std::shared_ptr<Bus>>& buses){
+std::vector<geo::Coordinates> MapRenderer::GetStopsCoordinates(const std::map<std::string_view, const Bus*>& buses){
     std::vector<geo::Coordinates> stop_coordinates;
     for(const auto& [bus_name, bus] : buses){
         for(const auto& stop : bus->route){
@@ -32,92 +55,268 @@ std::vector<geo::Coordinates> MapRenderer::GetStopsCoordinates(const std::map<st
     return stop_coordinates;
 }
 
+std::vector<svg::Point> MapRenderer::ProjectStops() const {
+    size_t size = 0;
+    for(const auto& [stop_name, stop] : stops_to_render_){
+        size = std::max(size, stop->id + 1);
+    }
+    std::vector<svg::Point> projected(size);
+    for(const auto& [stop_name, stop] : stops_to_render_){
+        projected[stop->id] = canvas_({stop->latitude, stop->longitude});
+    }
+    return projected;
+}
+
 svg::Color MapRenderer::ColorSelector(uint32_t index) {
     return svg::Color{renderer_settings_.color_palette[index % renderer_settings_.color_palette.size()]};
 }
 
-std::pair<svg::Text, svg::Text> MapRenderer::RenderSingleRouteName(std::shared_ptr<Bus> &bus, svg::Point text_coords, const svg::Color &color) {
-    svg::Text bus_label_underlayer = svg::Text()
-            .SetPosition(text_coords)
-            .SetOffset(renderer_settings_.bus_label_offset)
+MapRenderer::MapStyles MapRenderer::AddStyles(svg::FlatDocument& doc) const {
+    MapStyles styles;
+    for(const svg::Color& color : renderer_settings_.color_palette){
+        styles.routes.push_back(doc.AddStyle(svg::Style()
+                .SetFillColor(svg::NoneColor)
+                .SetStrokeColor(color)
+                .SetStrokeWidth(renderer_settings_.line_width)
+                .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)));
+        styles.bus_labels.push_back(doc.AddStyle(svg::Style().SetFillColor(color)));
+    }
+    styles.underlayer = doc.AddStyle(svg::Style()
             .SetFillColor(renderer_settings_.underlayer_color)
             .SetStrokeColor(renderer_settings_.underlayer_color)
-            .SetFontSize(renderer_settings_.bus_label_font_size)
-            .SetFontFamily("Verdana")
-            .SetFontWeight("bold")
             .SetStrokeWidth(renderer_settings_.underlayer_width)
             .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
+            .SetStrokeLineCap(svg::StrokeLineCap::ROUND));
+    styles.stop_circle = doc.AddStyle(svg::Style().SetFillColor("white"));
+    styles.stop_label = doc.AddStyle(svg::Style().SetFillColor("black"));
+    styles.bus_font = doc.AddFont({static_cast<uint32_t>(renderer_settings_.bus_label_font_size), "Verdana", "bold"});
+    styles.stop_font = doc.AddFont({static_cast<uint32_t>(renderer_settings_.stop_label_font_size), "Verdana", ""});
+    return styles;
+}
+
+void MapRenderer::RenderRouteName(svg::FlatDocument& doc, const Bus& bus, svg::Point text_coords,
+                                  const MapStyles& styles, svg::StyleId label_style) const {
+    doc.AddText(text_coords, renderer_settings_.bus_label_offset, styles.bus_font, styles.underlayer, bus.bus_name);
+    doc.AddText(text_coords, renderer_settings_.bus_label_offset, styles.bus_font, label_style, bus.bus_name);
+}
+
+void MapRenderer::RenderStopName(svg::FlatDocument& doc, const Stop* stop, const MapStyles& styles) const {
+    const svg::Point text_coords = Project(*stop);
+    doc.AddText(text_coords, renderer_settings_.stop_label_offset, styles.stop_font, styles.underlayer, stop->stop_name);
+    doc.AddText(text_coords, renderer_settings_.stop_label_offset, styles.stop_font, styles.stop_label, stop->stop_name);
+}
+
+void MapRenderer::RenderLayer(svg::FlatDocument& doc, const MapStyles& styles, Layer layer, size_t begin, size_t end,
+                              const std::vector<const Bus*>& buses, const std::vector<const Stop*>& stops) const {
+    //Цвет маршрута выбирается по кругу из палитры по его номеру, как в ColorSelector
+    auto palette_index = [this](size_t index) {
+        return index % renderer_settings_.color_palette.size();
+    };
+    for(size_t index = begin; index < end; ++index){
+        switch (layer) {
+            case Layer::ROUTES:
+                RenderRoute(doc, *buses[index], styles.routes[palette_index(index)]);
+                break;
+            case Layer::ROUTE_NAMES: {
+                const Bus* bus = buses[index];
+                const svg::StyleId label_style = styles.bus_labels[palette_index(index)];
+                svg::Point label_coords = Project(*bus->route.front());
+                RenderRouteName(doc, *bus, label_coords, styles, label_style);
+                if(!bus->is_circle && bus->route.front() != bus->route.back()){
+                    svg::Point end_label_coords = Project(*bus->route.back());
+                    RenderRouteName(doc, *bus, end_label_coords, styles, label_style);
+                }
+                break;
+            }
+            case Layer::STOP_CIRCLES:
+                doc.AddCircle(Project(*stops[index]), renderer_settings_.stop_radius, styles.stop_circle);
+                break;
+            case Layer::STOP_NAMES:
+                RenderStopName(doc, stops[index], styles);
+                break;
+        }
+    }
+}
+
+std::unordered_map<std::string_view, size_t> MapRenderer::NumberRoutes(const std::map<std::string_view, const Bus*>& buses) {
+    std::unordered_map<std::string_view, size_t> numbers;
+    numbers.reserve(buses.size());
+    for(const auto& [name, bus] : buses){
+        numbers.emplace(name, numbers.size());
+    }
+    return numbers;
+}
+
+std::vector<const Stop*> MapRenderer::StageStops(const BusTripEdges& stage) const {
+    const auto bus = routes_to_render_.find(stage.bus_name_);
+    if(bus == routes_to_render_.end()){
+        return {};
+    }
+    //Остановки в порядке движения автобуса, для некольцевого маршрута — туда и обратно, как в RoutePoints
+    const std::vector<const Stop*>& route = bus->second->route;
+    std::vector<const Stop*> sequence(route.begin(), route.end());
+    if(!bus->second->is_circle && !route.empty()){
+        sequence.insert(sequence.end(), route.rbegin() + 1, route.rend());
+    }
+    for(size_t first = 0; first + stage.span_count_ < sequence.size(); ++first){
+        if(sequence[first]->stop_name == stage.stops_.first
+           && sequence[first + stage.span_count_]->stop_name == stage.stops_.second){
+            return {sequence.begin() + first, sequence.begin() + first + stage.span_count_ + 1};
+        }
+    }
+    return {};
+}
+
+svg::FlatDocument MapRenderer::RenderRouteOverlay(const BusTripRoute& route) const {
+    svg::FlatDocument doc;
+    const MapStyles styles = AddStyles(doc);
+    const svg::StyleId halo = doc.AddStyle(svg::Style()
+            .SetFillColor(svg::NoneColor)
+            .SetStrokeColor(renderer_settings_.underlayer_color)
+            .SetStrokeWidth(2 * renderer_settings_.line_width + renderer_settings_.underlayer_width)
             .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-            .SetData({bus->bus_name.data(), bus->bus_name.size()});
-    svg::Text bus_label = svg::Text()
-            .SetPosition(text_coords)
-            .SetOffset(renderer_settings_.bus_label_offset)
-            .SetFillColor(color)
-            .SetFontSize(renderer_settings_.bus_label_font_size)
-            .SetFontFamily("Verdana")
-            .SetFontWeight("bold")
-            .SetData({bus->bus_name.data(), bus->bus_name.size()});
-    return {bus_label_underlayer, bus_label};
-}
-
-svg::Document MapRenderer::RenderMap() {
-    svg::Document doc;
-    uint32_t index = 0;
-    for(auto [bus_name, bus] : routes_to_render_){
-        doc.Add(RenderRoute(bus, ColorSelector(index)));
-        ++index;
-    }
-    index = 0;
-    for(auto [bus_name, bus] : routes_to_render_){
-        svg::Point label_coords = canvas_({bus->route.front()->latitude, bus->route.front()->longitude});
-        doc.Add((RenderSingleRouteName(bus, label_coords, ColorSelector(index)).first));
-        doc.Add((RenderSingleRouteName(bus, label_coords, ColorSelector(index)).second));
-        if(!bus->is_circle && bus->route.front() != bus->route.back()){
-            svg::Point end_label_coords = canvas_({bus->route.back()->latitude, bus->route.back()->longitude});
-            doc.Add((RenderSingleRouteName(bus, end_label_coords, ColorSelector(index)).first));
-            doc.Add((RenderSingleRouteName(bus, end_label_coords, ColorSelector(index)).second));
+            .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND));
+    std::vector<svg::StyleId> highlights;
+    for(const svg::Color& color : renderer_settings_.color_palette){
+        highlights.push_back(doc.AddStyle(svg::Style()
+                .SetFillColor(svg::NoneColor)
+                .SetStrokeColor(color)
+                .SetStrokeWidth(2 * renderer_settings_.line_width)
+                .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)));
+    }
+
+    std::vector<std::vector<const Stop*>> stages;
+    std::vector<svg::StyleId> stage_styles;
+    for(const BusTripEdges& stage : route.stages_){
+        stages.push_back(StageStops(stage));
+        //Цвет этапа — цвет его маршрута на карте
+        const auto number = route_numbers_.find(stage.bus_name_);
+        const size_t index = number == route_numbers_.end() ? 0 : number->second;
+        stage_styles.push_back(highlights[index % highlights.size()]);
+    }
+    for(const std::vector<const Stop*>& stops : stages){
+        doc.StartPolyline(halo);
+        for(const Stop* stop : stops){
+            doc.AddPoint(Project(*stop));
+        }
+    }
+    for(size_t i = 0; i < stages.size(); ++i){
+        doc.StartPolyline(stage_styles[i]);
+        for(const Stop* stop : stages[i]){
+            doc.AddPoint(Project(*stop));
+        }
+    }
+    //Остановка может встретиться в поездке несколько раз (пересадка, возврат по кольцу), её кружок рисуется один раз
+    std::unordered_set<const Stop*> drawn_stops;
+    for(const std::vector<const Stop*>& stops : stages){
+        for(const Stop* stop : stops){
+            if(drawn_stops.insert(stop).second){
+                doc.AddCircle(Project(*stop), renderer_settings_.stop_radius, styles.stop_circle);
+            }
         }
-        ++index;
     }
-    for(const auto& [stop_name, stop] :stops_to_render_){
-            doc.Add(RenderStopCircle(stop, "white"));
+    for(const std::vector<const Stop*>& stops : stages){
+        if(!stops.empty()){
+            RenderStopName(doc, stops.front(), styles);
+        }
     }
-    for(const auto& [stop_name, stop] :stops_to_render_){
-        doc.Add(RenderStopName(stop, "black").first);
-        doc.Add(RenderStopName(stop, "black").second);
+    if(!stages.empty() && !stages.back().empty()){
+        RenderStopName(doc, stages.back().back(), styles);
     }
     return doc;
 }
 
-svg::Circle MapRenderer::RenderStopCircle(const Stop* stop, const svg::Color &color) {
-    svg::Point circle_coords = canvas_({stop->latitude, stop->longitude});
-    svg::Circle circle = svg::Circle()
-            .SetCenter(circle_coords)
-            .SetRadius(renderer_settings_.stop_radius)
-            .SetFillColor(color);
-    return circle;
+svg::FlatDocument MapRenderer::RenderMap(size_t threads) {
+    static profile::Site site("map.render");
+    const profile::ScopedTimer timer(site);
+    std::vector<const Bus*> buses;
+    buses.reserve(routes_to_render_.size());
+    for(const auto& [bus_name, bus] : routes_to_render_){
+        buses.push_back(bus);
+    }
+    std::vector<const Stop*> stops;
+    stops.reserve(stops_to_render_.size());
+    for(const auto& [stop_name, stop] : stops_to_render_){
+        stops.push_back(stop);
+    }
+    if(renderer_settings_.simplify_tolerance > 0.0){
+        //Обзорная карта — уровень 0: остаются только остановки, видимые на нём
+        std::vector<svg::Point> positions;
+        positions.reserve(stops.size());
+        for(const Stop* stop : stops){
+            positions.push_back(Project(*stop));
+        }
+        const std::vector<int> levels = lod::MinZoomLevels(positions, renderer_settings_.simplify_tolerance, 0);
+        size_t kept = 0;
+        for(size_t i = 0; i < stops.size(); ++i){
+            if(levels[i] == 0){
+                stops[kept++] = stops[i];
+            }
+        }
+        stops.resize(kept);
+    }
+
+    //Порция слоя: диапазон его элементов
+    struct Chunk {
+        Layer layer;
+        size_t begin;
+        size_t end;
+    };
+    const size_t total = 2 * (buses.size() + stops.size());
+    const size_t chunk_size = std::max(MIN_RENDER_CHUNK, total / (std::max<size_t>(threads, 1) * RENDER_CHUNKS_PER_THREAD));
+    std::vector<Chunk> chunks;
+    auto add_chunks = [&chunks, threads, chunk_size](Layer layer, size_t count) {
+        if (threads <= 1) {
+            chunks.push_back({layer, 0, count});
+            return;
+        }
+        for(size_t begin = 0; begin < count; begin += chunk_size){
+            chunks.push_back({layer, begin, std::min(count, begin + chunk_size)});
+        }
+    };
+    add_chunks(Layer::ROUTES, buses.size());
+    add_chunks(Layer::ROUTE_NAMES, buses.size());
+    add_chunks(Layer::STOP_CIRCLES, stops.size());
+    add_chunks(Layer::STOP_NAMES, stops.size());
+
+    svg::FlatDocument doc;
+    if (threads <= 1 || chunks.size() <= 1) {
+        const MapStyles styles = AddStyles(doc);
+        for(const Chunk& chunk : chunks){
+            RenderLayer(doc, styles, chunk.layer, chunk.begin, chunk.end, buses, stops);
+        }
+        return doc;
+    }
+
+    //Каждая порция строится в свой документ, документы склеиваются в исходном порядке
+    std::vector<svg::FlatDocument> parts(chunks.size());
+    parallel::ParallelFor(chunks.size(), threads, [&](size_t index) {
+        const MapStyles styles = AddStyles(parts[index]);
+        RenderLayer(parts[index], styles, chunks[index].layer, chunks[index].begin, chunks[index].end, buses, stops);
+    });
+    for(const svg::FlatDocument& part : parts){
+        doc.Append(part);
+    }
+    return doc;
 }
 
-std::pair<svg::Text, svg::Text>
-MapRenderer::RenderStopName(const Stop* stop, const svg::Color &color) {
-    svg::Point text_coords = canvas_({stop->latitude, stop->longitude});
-    svg::Text stop_label_underlayer = svg::Text()
-            .SetPosition(text_coords)
-            .SetOffset(renderer_settings_.stop_label_offset)
-            .SetFillColor(renderer_settings_.underlayer_color)
-            .SetStrokeColor(renderer_settings_.underlayer_color)
-            .SetFontSize(renderer_settings_.stop_label_font_size)
-            .SetFontFamily("Verdana")
-            .SetStrokeWidth(renderer_settings_.underlayer_width)
-            .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
-            .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-            .SetData({stop->stop_name.data(), stop->stop_name.size()});
-    svg::Text stop_label = svg::Text()
-            .SetPosition(text_coords)
-            .SetOffset(renderer_settings_.stop_label_offset)
-            .SetFillColor(color)
-            .SetFontSize(renderer_settings_.stop_label_font_size)
-            .SetFontFamily("Verdana")
-            .SetData({stop->stop_name.data(), stop->stop_name.size()});
-    return {stop_label_underlayer, stop_label};
-}
\ No newline at end of file
+MapCache::Entry MapCache::Get(uint64_t catalogue_version, const RendererSettings& settings,
+                              const BuildScene& build, const RenderScene& render) const {
+    std::lock_guard guard(mutex_);
+    //Формат вывода на примитивы сцены не влияет
+    RendererSettings scene_settings = settings;
+    scene_settings.svg_output = settings_.svg_output;
+    if (!scene_ || catalogue_version_ != catalogue_version || !(settings_ == scene_settings)) {
+        scene_ = std::make_shared<const MapScene>(build());
+        svg_.reset();
+        catalogue_version_ = catalogue_version;
+        settings_ = scene_settings;
+    }
+    if (!svg_ || !(settings_.svg_output == settings.svg_output)) {
+        svg_ = std::make_shared<const std::string>(render(scene_->doc));
+        settings_.svg_output = settings.svg_output;
+    }
+    return {scene_, RenderedMap{svg_, {}}};
+}
@@ -1,10 +1,20 @@
 #pragma once
 
 #include "svg.h"
+#include "svg_flat.h"
 #include "geo.h"
 #include "domain.h"
+#include "parallel.h"
+#include "map_lod.h"
+#include "transport_router.h"
 #include <algorithm>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
 #include <utility>
 
 struct RendererSettings {
@@ -20,8 +30,16 @@ struct RendererSettings {
     svg::Color underlayer_color;
     double underlayer_width = 0.0;
     std::vector<svg::Color> color_palette;
+    // Необязательные compact_svg и svg_precision: формат вывода SVG
+    svg::RenderOptions svg_output;
+    // Необязательный simplify_tolerance: допуск упрощения карты в единицах холста (0 — без упрощения).
+    // Вершины линий, отклоняющиеся меньше допуска, отбрасываются, а остановка ближе допуска
+    // к уже выведенной выводится без кружка и названия
+    double simplify_tolerance = 0.0;
 };
 
+bool operator==(const RendererSettings& lhs, const RendererSettings& rhs);
+
 inline const double EPSILON = 1e-6;
 
 bool IsZero(double value);
@@ -83,26 +101,105 @@ private:
 
 class MapRenderer {
 public:
-    MapRenderer(const RendererSettings& settings, std::map<std::string_view, std::shared_ptr<Bus>> routes_to_render)
+    MapRenderer(const RendererSettings& settings, std::map<std::string_view, const Bus*> routes_to_render)
             : renderer_settings_(settings)
             , routes_to_render_(std::move(routes_to_render))
             {
     }
-    svg::Polyline RenderRoute(std::shared_ptr<Bus>& bus, const svg::Color& color);
     svg::Color ColorSelector(uint32_t index);
-    std::pair<svg::Text, svg::Text> RenderSingleRouteName(std::shared_ptr<Bus>& bus, svg::Point text_coords, const svg::Color& color);
-    svg::Circle RenderStopCircle(const Stop* stop, const svg::Color &color);
-    std::pair<svg::Text, svg::Text> RenderStopName(const Stop* stop, const svg::Color& color);
 
-    svg::Document RenderMap();
+    // Карта целиком: линии маршрутов, названия маршрутов, остановки и их названия.
+    // Слои и порции внутри слоёв строятся параллельно на threads потоках и склеиваются в порядке слоёв
+    svg::FlatDocument RenderMap(size_t threads = 1);
+
+    // Слой выделения маршрута поверх карты: линии этапов поездки вдвое толще линий маршрутов
+    // и на подложке, кружки всех пройденных остановок, названия остановок посадки и конечной
+    svg::FlatDocument RenderRouteOverlay(const BusTripRoute& route) const;
 
 private:
+    friend class MapTiles;
+
+    // Оформление и шрифты карты, общие для всех примитивов одного слоя
+    struct MapStyles {
+        std::vector<svg::StyleId> routes;      // по цвету палитры
+        std::vector<svg::StyleId> bus_labels;  // по цвету палитры
+        svg::StyleId underlayer = 0;
+        svg::StyleId stop_circle = 0;
+        svg::StyleId stop_label = 0;
+        svg::FontId bus_font = 0;
+        svg::FontId stop_font = 0;
+    };
+
+    // Слои карты в порядке вывода
+    enum class Layer {
+        ROUTES,
+        ROUTE_NAMES,
+        STOP_CIRCLES,
+        STOP_NAMES,
+    };
+
+    MapStyles AddStyles(svg::FlatDocument& doc) const;
+    // Элементы [begin, end) слоя: номера маршрутов в buses или остановок в stops
+    void RenderLayer(svg::FlatDocument& doc, const MapStyles& styles, Layer layer, size_t begin, size_t end,
+                     const std::vector<const Bus*>& buses, const std::vector<const Stop*>& stops) const;
+    void RenderRoute(svg::FlatDocument& doc, const Bus& bus, svg::StyleId style) const;
+    // Вершины линии маршрута на холсте: для некольцевого маршрута — туда и обратно
+    std::vector<svg::Point> RoutePoints(const Bus& bus) const;
+    void RenderRouteName(svg::FlatDocument& doc, const Bus& bus, svg::Point text_coords,
+                         const MapStyles& styles, svg::StyleId label_style) const;
+    void RenderStopName(svg::FlatDocument& doc, const Stop* stop, const MapStyles& styles) const;
+    // Остановки этапа поездки: span_count перегонов автобуса от stops_.first до stops_.second
+    std::vector<const Stop*> StageStops(const BusTripEdges& stage) const;
+    static std::unordered_map<std::string_view, size_t> NumberRoutes(const std::map<std::string_view, const Bus*>& buses);
+
     const RendererSettings& renderer_settings_;
-    std::map<std::string_view, std::shared_ptr<Bus>> routes_to_render_;
+    std::map<std::string_view, const Bus*> routes_to_render_;
+    // Номер маршрута в routes_to_render_, по которому выбирается цвет палитры
+    std::unordered_map<std::string_view, size_t> route_numbers_ = NumberRoutes(routes_to_render_);
     std::map<std::string_view, const Stop*> stops_to_render_;
-    std::vector<geo::Coordinates> GetStopsCoordinates(const std::map<std::string_view, std::shared_ptr<Bus>>& buses);
+    std::vector<geo::Coordinates> GetStopsCoordinates(const std::map<std::string_view, const Bus*>& buses);
     std::vector<geo::Coordinates> stop_coordinates_ = GetStopsCoordinates(routes_to_render_);
     const SphereProjector canvas_ = SphereProjector(stop_coordinates_.begin(), stop_coordinates_.end(),
                                                     renderer_settings_.width, renderer_settings_.height,
                                                     renderer_settings_.padding);
-};
\ No newline at end of file
+    // Проекции остановок маршрутов по Stop::id: каждая остановка проецируется один раз,
+    // сколько бы маршрутов через неё ни проходило
+    std::vector<svg::Point> projected_stops_ = ProjectStops();
+    std::vector<svg::Point> ProjectStops() const;
+    svg::Point Project(const Stop& stop) const {
+        return projected_stops_[stop.id];
+    }
+};
+
+// Сцена карты: отрисовщик с проекциями остановок и построенные им примитивы
+struct MapScene {
+    std::unique_ptr<const MapRenderer> renderer;
+    svg::FlatDocument doc;
+};
+
+// Кэш отрисованной карты. Сцена карты строится один раз для пары (версия справочника, настройки)
+// и сбрасывается, только когда меняется справочник или оформление.
+// Если изменился только формат вывода (svg_output), готовая сцена лишь сериализуется заново
+class MapCache {
+public:
+    using BuildScene = std::function<MapScene()>;
+    using RenderScene = std::function<std::string(const svg::FlatDocument&)>;
+
+    // Карта и сцена, из которой она выведена
+    struct Entry {
+        std::shared_ptr<const MapScene> scene;
+        RenderedMap map;
+    };
+
+    // Возвращает карту из кэша или строит её: сцену через build, текст через render.
+    // Потокобезопасен: одновременные запросы ждут одной отрисовки
+    Entry Get(uint64_t catalogue_version, const RendererSettings& settings,
+              const BuildScene& build, const RenderScene& render) const;
+
+private:
+    mutable std::mutex mutex_;
+    mutable uint64_t catalogue_version_ = 0;
+    mutable RendererSettings settings_;
+    mutable std::shared_ptr<const MapScene> scene_;
+    mutable std::shared_ptr<const std::string> svg_;
+};
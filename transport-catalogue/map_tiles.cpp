@@ -0,0 +1,448 @@
+#include "map_tiles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+
+namespace {
+    //Ячеек сетки примерно вчетверо меньше, чем элементов, но не больше 1024 на сторону
+    constexpr size_t ITEMS_PER_CELL = 4;
+    constexpr int MAX_GRID_LEVEL = 10;
+
+    //Оценка размеров подписи сверху: ширина символа не больше кегля, выносные элементы — до трети кегля
+    constexpr double GLYPH_WIDTH = 1.0;
+    constexpr double DESCENT = 0.3;
+
+    //Буфер векторного тайла в единицах его системы координат, как у обычных тайлов MVT
+    constexpr double VECTOR_TILE_BUFFER = 64.0;
+
+    bool Intersects(double min1, double max1, double min2, double max2) {
+        return min1 <= max2 && min2 <= max1;
+    }
+
+    //Отсечение отрезка ab прямоугольником (алгоритм Лианга — Барски): видимая часть — параметры [t0, t1]
+    std::optional<std::pair<double, double>> ClipSegment(svg::Point a, svg::Point b,
+                                                         double min_x, double min_y, double max_x, double max_y) {
+        double t0 = 0.0;
+        double t1 = 1.0;
+        auto clip = [&t0, &t1](double p, double q) {
+            if (p == 0.0) {
+                return q >= 0.0;
+            }
+            const double r = q / p;
+            if (p < 0.0) {
+                if (r > t1) {
+                    return false;
+                }
+                t0 = std::max(t0, r);
+            } else {
+                if (r < t0) {
+                    return false;
+                }
+                t1 = std::min(t1, r);
+            }
+            return true;
+        };
+        const double dx = b.x - a.x;
+        const double dy = b.y - a.y;
+        if (clip(-dx, a.x - min_x) && clip(dx, max_x - a.x) && clip(-dy, a.y - min_y) && clip(dy, max_y - a.y)) {
+            return std::pair{t0, t1};
+        }
+        return std::nullopt;
+    }
+
+    svg::Point Lerp(svg::Point a, svg::Point b, double t) {
+        return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+    }
+}//namespace
+
+std::vector<std::vector<svg::Point>> MapTiles::ClipPolyline(const std::vector<svg::Point>& points, const Box& box) {
+    std::vector<std::vector<svg::Point>> parts;
+    std::vector<svg::Point> part;
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        const auto clip = ClipSegment(points[i], points[i + 1], box.min_x, box.min_y, box.max_x, box.max_y);
+        if (!clip) {
+            continue;
+        }
+        const auto [t0, t1] = *clip;
+        //Отрезок входит в прямоугольник снаружи — начинается новая часть
+        if (part.empty() || t0 > 0.0) {
+            if (part.size() > 1) {
+                parts.push_back(std::move(part));
+            }
+            part = {Lerp(points[i], points[i + 1], t0)};
+        }
+        part.push_back(Lerp(points[i], points[i + 1], t1));
+        if (t1 < 1.0) {
+            parts.push_back(std::move(part));
+            part.clear();
+        }
+    }
+    if (part.size() > 1) {
+        parts.push_back(std::move(part));
+    }
+    return parts;
+}
+
+//---------------------Методы класса MapTiles::Grid-----------------
+
+MapTiles::Grid::Grid(double side, const std::vector<Box>& boxes) {
+    int level = 0;
+    while (level < MAX_GRID_LEVEL && (size_t{1} << (2 * level)) * ITEMS_PER_CELL < boxes.size()) {
+        ++level;
+    }
+    cells_per_side_ = 1 << level;
+    cell_size_ = side > 0.0 ? side / cells_per_side_ : 1.0;
+
+    //Два прохода: сначала считаем элементы каждой ячейки, затем раскладываем номера
+    const size_t cell_count = static_cast<size_t>(cells_per_side_) * cells_per_side_;
+    offsets_.assign(cell_count + 1, 0);
+    auto for_each_cell = [this](const Box& box, auto&& action) {
+        const auto [first_x, last_x] = CellRange(box.min_x, box.max_x);
+        const auto [first_y, last_y] = CellRange(box.min_y, box.max_y);
+        for (int y = first_y; y <= last_y; ++y) {
+            for (int x = first_x; x <= last_x; ++x) {
+                action(static_cast<size_t>(y) * cells_per_side_ + x);
+            }
+        }
+    };
+    for (const Box& box : boxes) {
+        for_each_cell(box, [this](size_t cell) {
+            ++offsets_[cell + 1];
+        });
+    }
+    for (size_t cell = 0; cell < cell_count; ++cell) {
+        offsets_[cell + 1] += offsets_[cell];
+    }
+    items_.resize(offsets_.back());
+    std::vector<uint32_t> filled(offsets_.begin(), offsets_.end() - 1);
+    for (uint32_t item = 0; item < boxes.size(); ++item) {
+        for_each_cell(boxes[item], [this, &filled, item](size_t cell) {
+            items_[filled[cell]++] = item;
+        });
+    }
+}
+
+std::pair<int, int> MapTiles::Grid::CellRange(double min, double max) const {
+    //Всё, что выходит за холст, попадает в крайние ячейки
+    auto cell = [this](double coordinate) {
+        const double index = std::floor(coordinate / cell_size_);
+        return static_cast<int>(std::clamp(index, 0.0, static_cast<double>(cells_per_side_ - 1)));
+    };
+    return {cell(min), cell(max)};
+}
+
+std::vector<uint32_t> MapTiles::Grid::Query(const Box& box) const {
+    std::vector<uint32_t> result;
+    const auto [first_x, last_x] = CellRange(box.min_x, box.max_x);
+    const auto [first_y, last_y] = CellRange(box.min_y, box.max_y);
+    for (int y = first_y; y <= last_y; ++y) {
+        for (int x = first_x; x <= last_x; ++x) {
+            const size_t cell = static_cast<size_t>(y) * cells_per_side_ + x;
+            result.insert(result.end(), items_.begin() + offsets_[cell], items_.begin() + offsets_[cell + 1]);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+//---------------------Методы класса MapTiles-----------------------
+
+MapTiles::MapTiles(RendererSettings settings, std::map<std::string_view, const Bus*> routes_to_render)
+        : settings_(std::move(settings))
+        , renderer_(settings_, std::move(routes_to_render))
+        , side_(std::max(settings_.width, settings_.height))
+        , grid_(side_, BuildItems()) {
+}
+
+MapTiles::Box MapTiles::LabelBox(svg::Point position, svg::Point offset, int font_size, std::string_view text) const {
+    const double x = position.x + offset.x;
+    const double y = position.y + offset.y;
+    const double halo = settings_.underlayer_width / 2;
+    return {x - halo, y - font_size - halo,
+            x + GLYPH_WIDTH * font_size * static_cast<double>(text.size()) + halo, y + DESCENT * font_size + halo};
+}
+
+const std::vector<MapTiles::Box>& MapTiles::BuildItems() {
+    for (const auto& [bus_name, bus] : renderer_.routes_to_render_) {
+        const uint32_t route = static_cast<uint32_t>(routes_.size());
+        routes_.push_back({bus, static_cast<uint32_t>(points_.size())});
+        const std::vector<svg::Point> route_points = renderer_.RoutePoints(*bus);
+        points_.insert(points_.end(), route_points.begin(), route_points.end());
+        for (uint32_t point = routes_.back().first_point; point + 1 < points_.size(); ++point) {
+            segments_.push_back({route, point});
+        }
+    }
+    for (uint32_t route = 0; route < routes_.size(); ++route) {
+        const Bus* bus = routes_[route].bus;
+        bus_labels_.push_back({route, points_[routes_[route].first_point]});
+        if (!bus->is_circle && bus->route.front() != bus->route.back()) {
+            bus_labels_.push_back({route, renderer_.Project(*bus->route.back())});
+        }
+    }
+    std::vector<svg::Point> stop_positions;
+    for (const auto& [stop_name, stop] : renderer_.stops_to_render_) {
+        stops_.push_back({stop, renderer_.Project(*stop), 0});
+        stop_positions.push_back(stops_.back().position);
+    }
+    if (settings_.simplify_tolerance > 0.0) {
+        const std::vector<int> levels = lod::MinZoomLevels(stop_positions, settings_.simplify_tolerance, MAX_TILE_ZOOM);
+        for (size_t i = 0; i < stops_.size(); ++i) {
+            stops_[i].min_zoom = levels[i];
+        }
+    }
+
+    boxes_.reserve(segments_.size() + bus_labels_.size() + stops_.size());
+    const double half_line = settings_.line_width / 2;
+    for (const Segment& segment : segments_) {
+        const svg::Point a = points_[segment.point];
+        const svg::Point b = points_[segment.point + 1];
+        boxes_.push_back({std::min(a.x, b.x) - half_line, std::min(a.y, b.y) - half_line,
+                         std::max(a.x, b.x) + half_line, std::max(a.y, b.y) + half_line});
+    }
+    for (const BusLabel& label : bus_labels_) {
+        boxes_.push_back(LabelBox(label.position, settings_.bus_label_offset, settings_.bus_label_font_size,
+                                 routes_[label.route].bus->bus_name));
+    }
+    //Рамка остановки охватывает и кружок, и подпись
+    for (const StopItem& item : stops_) {
+        Box box = LabelBox(item.position, settings_.stop_label_offset, settings_.stop_label_font_size,
+                           item.stop->stop_name);
+        box.min_x = std::min(box.min_x, item.position.x - settings_.stop_radius);
+        box.min_y = std::min(box.min_y, item.position.y - settings_.stop_radius);
+        box.max_x = std::max(box.max_x, item.position.x + settings_.stop_radius);
+        box.max_y = std::max(box.max_y, item.position.y + settings_.stop_radius);
+        boxes_.push_back(box);
+    }
+    return boxes_;
+}
+
+MapTiles::Box MapTiles::TileBounds(const TileQuery& tile) const {
+    if (tile.z < 0 || tile.z > MAX_TILE_ZOOM) {
+        throw std::invalid_argument("Tile zoom must be in [0, " + std::to_string(MAX_TILE_ZOOM) + "]");
+    }
+    const double tile_side = std::ldexp(side_, -tile.z);
+    return {tile.x * tile_side, tile.y * tile_side, (tile.x + 1) * tile_side, (tile.y + 1) * tile_side};
+}
+
+bool MapTiles::IsOnMap(const TileQuery& tile) {
+    const int tiles_per_side = 1 << tile.z;
+    return tile.x >= 0 && tile.y >= 0 && tile.x < tiles_per_side && tile.y < tiles_per_side;
+}
+
+std::vector<uint32_t> MapTiles::SelectItems(const Box& bounds, int zoom) const {
+    const uint32_t first_label = static_cast<uint32_t>(segments_.size());
+    const uint32_t first_stop = first_label + static_cast<uint32_t>(bus_labels_.size());
+    std::vector<uint32_t> items = grid_.Query(bounds);
+    //Рамки из сетки проверяются точно, отрезки — с учётом толщины линии
+    const double half_line = settings_.line_width / 2;
+    items.erase(std::remove_if(items.begin(), items.end(), [&](uint32_t item) {
+        const Box& box = boxes_[item];
+        if (!Intersects(box.min_x, box.max_x, bounds.min_x, bounds.max_x)
+            || !Intersects(box.min_y, box.max_y, bounds.min_y, bounds.max_y)) {
+            return true;
+        }
+        if (item >= first_stop) {
+            return stops_[item - first_stop].min_zoom > zoom;
+        }
+        if (item < first_label) {
+            const Segment& segment = segments_[item];
+            return !ClipSegment(points_[segment.point], points_[segment.point + 1],
+                                bounds.min_x - half_line, bounds.min_y - half_line,
+                                bounds.max_x + half_line, bounds.max_y + half_line);
+        }
+        return false;
+    }), items.end());
+    return items;
+}
+
+size_t MapTiles::CollectRun(const std::vector<uint32_t>& items, size_t begin, std::vector<svg::Point>& run) const {
+    const Segment& first = segments_[items[begin]];
+    run.assign({points_[first.point], points_[first.point + 1]});
+    size_t end = begin + 1;
+    for (; end < items.size() && items[end] == items[end - 1] + 1 && segments_[items[end]].route == first.route; ++end) {
+        run.push_back(points_[segments_[items[end]].point + 1]);
+    }
+    return end;
+}
+
+svg::FlatDocument MapTiles::RenderTile(const TileQuery& tile) const {
+    const Box bounds = TileBounds(tile);
+    const double tile_side = bounds.max_x - bounds.min_x;
+
+    svg::FlatDocument doc;
+    doc.SetViewBox({bounds.min_x, bounds.min_y}, tile_side, tile_side);
+    if (!IsOnMap(tile)) {
+        return doc;
+    }
+
+    const MapRenderer::MapStyles styles = renderer_.AddStyles(doc);
+    auto palette_index = [this](uint32_t route) {
+        return route % settings_.color_palette.size();
+    };
+    const uint32_t first_label = static_cast<uint32_t>(segments_.size());
+    const uint32_t first_stop = first_label + static_cast<uint32_t>(bus_labels_.size());
+    const std::vector<uint32_t> items = SelectItems(bounds, tile.z);
+
+    //Соседние отрезки одного маршрута идут в одну ломаную. Конец оборванной ломаной лежит
+    //за пределами тайла дальше половины толщины линии, поэтому скругления на обрыве не видны.
+    //Допуск упрощения задан для всей карты, а на уровне z тайл увеличен в 2^z раз
+    const double tolerance = std::ldexp(settings_.simplify_tolerance, -tile.z);
+    std::vector<svg::Point> run;
+    size_t index = 0;
+    while (index < items.size() && items[index] < first_label) {
+        const uint32_t route = segments_[items[index]].route;
+        index = CollectRun(items, index, run);
+        doc.StartPolyline(styles.routes[palette_index(route)]);
+        for (const svg::Point point : lod::Simplify(run, tolerance)) {
+            doc.AddPoint(point);
+        }
+    }
+    for (; index < items.size() && items[index] < first_stop; ++index) {
+        const BusLabel& label = bus_labels_[items[index] - first_label];
+        renderer_.RenderRouteName(doc, *routes_[label.route].bus, label.position, styles,
+                                  styles.bus_labels[palette_index(label.route)]);
+    }
+    const size_t stops_begin = index;
+    for (; index < items.size(); ++index) {
+        doc.AddCircle(stops_[items[index] - first_stop].position, settings_.stop_radius, styles.stop_circle);
+    }
+    for (index = stops_begin; index < items.size(); ++index) {
+        renderer_.RenderStopName(doc, stops_[items[index] - first_stop].stop, styles);
+    }
+    return doc;
+}
+
+std::string MapTiles::EncodeVectorTile(const TileQuery& tile) const {
+    const Box bounds = TileBounds(tile);
+    if (!IsOnMap(tile)) {
+        return {};
+    }
+    const double tile_side = bounds.max_x - bounds.min_x;
+    const double scale = vector_tile::EXTENT / tile_side;
+    const double buffer = VECTOR_TILE_BUFFER / scale;
+    const Box buffered{bounds.min_x - buffer, bounds.min_y - buffer, bounds.max_x + buffer, bounds.max_y + buffer};
+    auto to_tile = [&bounds, scale](svg::Point point) {
+        return vector_tile::Point{static_cast<int32_t>(std::lround((point.x - bounds.min_x) * scale)),
+                                  static_cast<int32_t>(std::lround((point.y - bounds.min_y) * scale))};
+    };
+    auto in_buffer = [&buffered](svg::Point point) {
+        return Intersects(point.x, point.x, buffered.min_x, buffered.max_x)
+               && Intersects(point.y, point.y, buffered.min_y, buffered.max_y);
+    };
+    auto route_tags = [this](uint32_t route) {
+        const Bus& bus = *routes_[route].bus;
+        return vector_tile::Tags{{"name", std::string(bus.bus_name)},
+                                 {"palette", static_cast<uint64_t>(route % settings_.color_palette.size())},
+                                 {"is_roundtrip", bus.is_circle}};
+    };
+
+    const uint32_t first_label = static_cast<uint32_t>(segments_.size());
+    const uint32_t first_stop = first_label + static_cast<uint32_t>(bus_labels_.size());
+    const std::vector<uint32_t> items = SelectItems(buffered, tile.z);
+    std::vector<vector_tile::Layer> layers{vector_tile::Layer("routes"), vector_tile::Layer("route_labels"),
+                                           vector_tile::Layer("stops")};
+
+    //Все куски одного маршрута в тайле — один объект из нескольких ломаных, обрезанных по буферу тайла
+    const double tolerance = std::ldexp(settings_.simplify_tolerance, -tile.z);
+    std::vector<svg::Point> run;
+    std::vector<std::vector<vector_tile::Point>> lines;
+    size_t index = 0;
+    while (index < items.size() && items[index] < first_label) {
+        const uint32_t route = segments_[items[index]].route;
+        lines.clear();
+        while (index < items.size() && items[index] < first_label && segments_[items[index]].route == route) {
+            index = CollectRun(items, index, run);
+            for (const std::vector<svg::Point>& part : ClipPolyline(run, buffered)) {
+                std::vector<vector_tile::Point>& line = lines.emplace_back();
+                for (const svg::Point point : lod::Simplify(part, tolerance)) {
+                    line.push_back(to_tile(point));
+                }
+            }
+        }
+        layers[0].AddLines(route + 1, lines, route_tags(route));
+    }
+    //Подписи и остановки — точки привязки; подпись, выступающая из соседнего тайла, хранится в нём
+    for (; index < items.size() && items[index] < first_stop; ++index) {
+        const BusLabel& label = bus_labels_[items[index] - first_label];
+        if (in_buffer(label.position)) {
+            layers[1].AddPoint(items[index] - first_label + 1, to_tile(label.position), route_tags(label.route));
+        }
+    }
+    for (; index < items.size(); ++index) {
+        const StopItem& item = stops_[items[index] - first_stop];
+        if (in_buffer(item.position)) {
+            layers[2].AddPoint(item.stop->id + 1, to_tile(item.position),
+                               {{"name", std::string(item.stop->stop_name)}});
+        }
+    }
+    return vector_tile::EncodeTile(layers);
+}
+
+void MapTiles::ForEachVectorTile(int max_zoom, const std::function<void(const TileQuery&, const std::string&)>& action,
+                                 const TileQuery& tile) const {
+    const std::string data = EncodeVectorTile(tile);
+    if (!data.empty()) {
+        action(tile, data);
+    }
+    if (tile.z >= max_zoom) {
+        return;
+    }
+    //Спускаемся только в тайлы, где есть хоть что-то, с учётом остановок, скрытых на этом уровне
+    const Box bounds = TileBounds(tile);
+    const double buffer = VECTOR_TILE_BUFFER * (bounds.max_x - bounds.min_x) / vector_tile::EXTENT;
+    if (SelectItems({bounds.min_x - buffer, bounds.min_y - buffer, bounds.max_x + buffer, bounds.max_y + buffer},
+                    MAX_TILE_ZOOM).empty()) {
+        return;
+    }
+    for (int dy = 0; dy < 2; ++dy) {
+        for (int dx = 0; dx < 2; ++dx) {
+            ForEachVectorTile(max_zoom, action, {tile.z + 1, 2 * tile.x + dx, 2 * tile.y + dy});
+        }
+    }
+}
+
+//---------------------Методы класса TileCache----------------------
+
+TileCache::TileCache(size_t capacity)
+        : capacity_(capacity) {
+}
+
+RenderedMap TileCache::Get(uint64_t catalogue_version, const RendererSettings& settings, const TileQuery& tile,
+                           const std::function<std::unique_ptr<MapTiles>()>& build,
+                           const std::function<std::string(const MapTiles&)>& render) const {
+    const Key key{tile.z, tile.x, tile.y, catalogue_version};
+    std::shared_ptr<const MapTiles> tiles;
+    {
+        std::lock_guard guard(mutex_);
+        if (!tiles_ || catalogue_version_ != catalogue_version || !(settings_ == settings)) {
+            tiles_ = build();
+            catalogue_version_ = catalogue_version;
+            settings_ = settings;
+            cache_.clear();
+            order_.clear();
+        }
+        if (const auto it = cache_.find(key); it != cache_.end()) {
+            return RenderedMap{it->second, {}};
+        }
+        tiles = tiles_;
+    }
+
+    //Отрисовка идёт без блокировки; если тайл успели отрисовать в другом потоке, берётся готовый
+    auto svg = std::make_shared<const std::string>(render(*tiles));
+    std::lock_guard guard(mutex_);
+    if (tiles != tiles_) {
+        return RenderedMap{svg, {}};
+    }
+    const auto [it, inserted] = cache_.emplace(key, svg);
+    if (inserted) {
+        order_.push_back(key);
+        if (order_.size() > capacity_) {
+            cache_.erase(order_.front());
+            order_.pop_front();
+        }
+    }
+    return RenderedMap{it->second, {}};
+}
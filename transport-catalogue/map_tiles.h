@@ -0,0 +1,143 @@
+#pragma once
+
+#include "map_renderer.h"
+#include "vector_tile.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+inline constexpr int MAX_TILE_ZOOM = 30;
+
+// Тайлы карты. На уровне z холст карты (width × height из RendererSettings) делится на 2^z × 2^z
+// квадратов со стороной max(width, height) / 2^z; тайл (0, 0, 0) покрывает всю карту.
+// Проекция, оформление и порядок слоёв те же, что у MapRenderer::RenderMap, но в тайл попадают
+// только линии, остановки и подписи, задевающие его границы
+class MapTiles {
+public:
+    MapTiles(RendererSettings settings, std::map<std::string_view, const Bus*> routes_to_render);
+
+    MapTiles(const MapTiles&) = delete;
+    MapTiles& operator=(const MapTiles&) = delete;
+
+    // Тайл с атрибутом viewBox по его границам. Тайл за пределами карты пуст
+    svg::FlatDocument RenderTile(const TileQuery& tile) const;
+
+    // Тот же тайл в формате Mapbox Vector Tile: слои routes (name, palette, is_roundtrip),
+    // route_labels (name, palette) и stops (name). Линии обрезаются по границам тайла с буфером.
+    // Тайл за пределами карты или без объектов — пустая строка
+    std::string EncodeVectorTile(const TileQuery& tile) const;
+
+    // Непустые векторные тайлы уровней от tile.z до max_zoom внутри tile; пустые ветви пропускаются
+    void ForEachVectorTile(int max_zoom, const std::function<void(const TileQuery&, const std::string&)>& action,
+                           const TileQuery& tile = {}) const;
+
+private:
+    // Прямоугольник на холсте
+    struct Box {
+        double min_x = 0.0;
+        double min_y = 0.0;
+        double max_x = 0.0;
+        double max_y = 0.0;
+    };
+
+    // Отрезок линии маршрута между соседними вершинами ломаной
+    struct Segment {
+        uint32_t route;
+        uint32_t point;
+    };
+
+    // Линия маршрута: вершины лежат в points_ подряд
+    struct Route {
+        const Bus* bus;
+        uint32_t first_point;
+    };
+
+    struct BusLabel {
+        uint32_t route;
+        svg::Point position;
+    };
+
+    struct StopItem {
+        const Stop* stop;
+        svg::Point position;
+        int min_zoom; // наименьший уровень, на котором остановка не скрыта прореживанием
+    };
+
+    // Равномерная сетка над холстом: для каждой ячейки — номера элементов, рамки которых её задевают.
+    // Номера хранятся подряд (offsets_ — начало списка каждой ячейки)
+    class Grid {
+    public:
+        Grid(double side, const std::vector<Box>& boxes);
+
+        // Номера элементов из ячеек, которые задевает box, по возрастанию и без повторов
+        std::vector<uint32_t> Query(const Box& box) const;
+
+    private:
+        double cell_size_ = 1.0;
+        int cells_per_side_ = 1;
+        std::vector<uint32_t> offsets_;
+        std::vector<uint32_t> items_;
+
+        // Диапазон ячеек [first, last] по одной оси
+        std::pair<int, int> CellRange(double min, double max) const;
+    };
+
+    const RendererSettings settings_;
+    const MapRenderer renderer_;
+    const double side_;
+
+    // Элементы пронумерованы в порядке вывода на карте: отрезки маршрутов, подписи маршрутов, остановки.
+    // Поэтому отсортированные номера из сетки сразу идут в нужном порядке слоёв
+    std::vector<Route> routes_;
+    std::vector<svg::Point> points_;
+    std::vector<Segment> segments_;
+    std::vector<BusLabel> bus_labels_;
+    std::vector<StopItem> stops_;
+    std::vector<Box> boxes_;
+    Grid grid_;
+
+    // Заполняет массивы элементов и возвращает их рамки (boxes_)
+    const std::vector<Box>& BuildItems();
+    Box LabelBox(svg::Point position, svg::Point offset, int font_size, std::string_view text) const;
+
+    Box TileBounds(const TileQuery& tile) const;
+    static bool IsOnMap(const TileQuery& tile);
+    // Номера элементов, задевающих bounds и видимых на уровне zoom, в порядке слоёв
+    std::vector<uint32_t> SelectItems(const Box& bounds, int zoom) const;
+    // Вершины ломаной из подряд идущих отрезков одного маршрута, начиная с items[begin].
+    // Возвращает номер первого элемента после неё
+    size_t CollectRun(const std::vector<uint32_t>& items, size_t begin, std::vector<svg::Point>& run) const;
+    // Части ломаной внутри box
+    static std::vector<std::vector<svg::Point>> ClipPolyline(const std::vector<svg::Point>& points, const Box& box);
+};
+
+// Кэш тайлов по (z, x, y, версия справочника). Сетка MapTiles строится один раз
+// на версию справочника и настройки, тайлы отрисовываются по требованию
+class TileCache {
+public:
+    explicit TileCache(size_t capacity = 4096);
+
+    // Тайл из кэша или отрисованный через render. build создаёт MapTiles для новой версии справочника.
+    // Потокобезопасен; разные тайлы отрисовываются параллельно
+    RenderedMap Get(uint64_t catalogue_version, const RendererSettings& settings, const TileQuery& tile,
+                    const std::function<std::unique_ptr<MapTiles>()>& build,
+                    const std::function<std::string(const MapTiles&)>& render) const;
+
+private:
+    using Key = std::tuple<int, int, int, uint64_t>;
+
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    mutable uint64_t catalogue_version_ = 0;
+    mutable RendererSettings settings_;
+    mutable std::shared_ptr<const MapTiles> tiles_;
+    mutable std::map<Key, std::shared_ptr<const std::string>> cache_;
+    mutable std::deque<Key> order_; // порядок добавления: при переполнении вытесняются самые старые тайлы
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace memory {
+
+    // Занимаемая память: полезные байты и оценка накладных расходов аллокатора
+    struct Usage {
+        size_t bytes = 0;
+        size_t overhead = 0;
+
+        size_t Total() const {
+            return bytes + overhead;
+        }
+
+        Usage& operator+=(const Usage& other) {
+            bytes += other.bytes;
+            overhead += other.overhead;
+            return *this;
+        }
+    };
+
+    inline Usage operator+(Usage lhs, const Usage& rhs) {
+        return lhs += rhs;
+    }
+
+    // Отчёт по составным частям структуры: имя части -> занимаемая память
+    using Report = std::map<std::string, Usage>;
+
+    inline Usage Sum(const Report& report) {
+        Usage total;
+        for (const auto& [name, usage] : report) {
+            total += usage;
+        }
+        return total;
+    }
+
+    // Один блок из кучи. Оценка для 64-битного glibc malloc:
+    // 8 байт заголовка, выравнивание на 16, минимальный блок 32 байта
+    inline Usage HeapBlock(size_t bytes) {
+        if (bytes == 0) {
+            return {};
+        }
+        size_t chunk = (bytes + sizeof(size_t) + 15) & ~size_t{15};
+        if (chunk < 32) {
+            chunk = 32;
+        }
+        return {bytes, chunk - bytes};
+    }
+
+    // Динамическая память строки (короткие строки хранятся внутри объекта)
+    inline Usage Heap(const std::string& str) {
+        if (str.capacity() < sizeof(std::string) / 2) {
+            return {};
+        }
+        return HeapBlock(str.capacity() + 1);
+    }
+
+    // Далее функции Heap считают только динамическую память контейнера без учёта
+    // динамической памяти элементов. Для вложенных данных её нужно прибавить отдельно
+
+    template <typename T>
+    Usage Heap(const std::vector<T>& vec) {
+        return HeapBlock(vec.capacity() * sizeof(T));
+    }
+
+    template <typename T>
+    Usage Heap(const std::deque<T>& deq) {
+        constexpr size_t block_size = 512;
+        constexpr size_t elements_per_block = sizeof(T) < block_size ? block_size / sizeof(T) : 1;
+        const size_t blocks = deq.size() / elements_per_block + 1;
+        Usage usage;
+        for (size_t i = 0; i < blocks; ++i) {
+            usage += HeapBlock(elements_per_block * sizeof(T));
+        }
+        usage += HeapBlock(std::max<size_t>(8, blocks + 2) * sizeof(void*));
+        return usage;
+    }
+
+    // Узел красно-чёрного дерева: цвет и три указателя + значение
+    template <typename Tree>
+    Usage TreeHeap(const Tree& tree) {
+        Usage node = HeapBlock(4 * sizeof(void*) + sizeof(typename Tree::value_type));
+        return {node.bytes * tree.size(), node.overhead * tree.size()};
+    }
+
+    template <typename Key, typename Value, typename Compare>
+    Usage Heap(const std::map<Key, Value, Compare>& tree) {
+        return TreeHeap(tree);
+    }
+
+    template <typename Key, typename Compare>
+    Usage Heap(const std::set<Key, Compare>& tree) {
+        return TreeHeap(tree);
+    }
+
+    // Узел хеш-таблицы: указатель на следующий узел + значение (+ кешированный хеш для нецелых ключей),
+    // плюс массив корзин
+    template <typename Key, typename Value, typename Hash>
+    Usage Heap(const std::unordered_map<Key, Value, Hash>& table) {
+        constexpr size_t cached_hash = std::is_integral_v<Key> ? 0 : sizeof(size_t);
+        Usage node = HeapBlock(sizeof(void*) + sizeof(std::pair<const Key, Value>) + cached_hash);
+        Usage usage{node.bytes * table.size(), node.overhead * table.size()};
+        if (table.bucket_count() > 1) {
+            usage += HeapBlock(table.bucket_count() * sizeof(void*));
+        }
+        return usage;
+    }
+
+}//namespace memory
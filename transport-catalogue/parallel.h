@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    // Число потоков по умолчанию
+    inline size_t DefaultThreadCount() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    namespace detail {
+        // Диапазон индексов [begin, end) одного потока, упакованный в одно 64-битное слово,
+        // чтобы владелец (с начала) и воры (с конца) изменяли его одной атомарной операцией
+        class alignas(64) StealableRange {
+        public:
+            void Reset(uint32_t begin, uint32_t end) {
+                range_.store(Pack(begin, end), std::memory_order_release);
+            }
+
+            // Владелец забирает очередной индекс с начала диапазона
+            bool PopFront(uint32_t& index) {
+                uint64_t range = range_.load(std::memory_order_acquire);
+                while (Begin(range) < End(range)) {
+                    if (range_.compare_exchange_weak(range, Pack(Begin(range) + 1, End(range)),
+                                                     std::memory_order_acq_rel)) {
+                        index = Begin(range);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Вор забирает вторую половину оставшегося диапазона
+            bool StealHalf(uint32_t& begin, uint32_t& end) {
+                uint64_t range = range_.load(std::memory_order_acquire);
+                while (Begin(range) < End(range)) {
+                    const uint32_t middle = Begin(range) + (End(range) - Begin(range)) / 2;
+                    if (range_.compare_exchange_weak(range, Pack(Begin(range), middle),
+                                                     std::memory_order_acq_rel)) {
+                        begin = middle;
+                        end = End(range);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            uint32_t Size() const {
+                const uint64_t range = range_.load(std::memory_order_relaxed);
+                return End(range) > Begin(range) ? End(range) - Begin(range) : 0;
+            }
+
+        private:
+            std::atomic<uint64_t> range_{0};
+
+            static uint64_t Pack(uint32_t begin, uint32_t end) {
+                return (static_cast<uint64_t>(begin) << 32) | end;
+            }
+            static uint32_t Begin(uint64_t range) {
+                return static_cast<uint32_t>(range >> 32);
+            }
+            static uint32_t End(uint64_t range) {
+                return static_cast<uint32_t>(range);
+            }
+        };
+    }//namespace detail
+
+    namespace detail {
+        // Один проход ParallelFor: каждый поток начинает со своей равной части индексов, закончив её —
+        // забирает половину самой большой оставшейся части у других потоков
+        template <typename Func>
+        class StealingLoop {
+        public:
+            StealingLoop(size_t count, size_t threads, Func& func)
+                    : ranges_(threads)
+                    , func_(func) {
+                for (size_t t = 0; t < threads; ++t) {
+                    ranges_[t].Reset(static_cast<uint32_t>(count * t / threads),
+                                     static_cast<uint32_t>(count * (t + 1) / threads));
+                }
+            }
+
+            // Работа потока self; исключение из func запоминается и останавливает остальные потоки
+            void Work(size_t self) noexcept {
+                try {
+                    while (!failed_.load(std::memory_order_relaxed)) {
+                        uint32_t index;
+                        if (ranges_[self].PopFront(index)) {
+                            func_(index);
+                            continue;
+                        }
+                        //Своя часть закончилась — ищем самую большую чужую
+                        size_t victim = self;
+                        uint32_t victim_size = 0;
+                        for (size_t t = 0; t < ranges_.size(); ++t) {
+                            if (const uint32_t size = ranges_[t].Size(); t != self && size > victim_size) {
+                                victim = t;
+                                victim_size = size;
+                            }
+                        }
+                        if (victim_size == 0) {
+                            return;
+                        }
+                        uint32_t begin, end;
+                        if (ranges_[victim].StealHalf(begin, end)) {
+                            ranges_[self].Reset(begin, end);
+                        }
+                    }
+                } catch (...) {
+                    std::lock_guard guard(error_mutex_);
+                    if (!error_) {
+                        error_ = std::current_exception();
+                    }
+                    failed_.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            // Останавливает потоки: оставшиеся индексы не обрабатываются
+            void Stop() {
+                failed_.store(true, std::memory_order_relaxed);
+            }
+
+            // Пробрасывает первое исключение из func
+            void Rethrow() const {
+                if (error_) {
+                    std::rethrow_exception(error_);
+                }
+            }
+
+        private:
+            std::vector<StealableRange> ranges_;
+            Func& func_;
+            std::atomic<bool> failed_{false};
+            std::exception_ptr error_;
+            std::mutex error_mutex_;
+        };
+
+        inline void CheckTaskCount(size_t count) {
+            if (count > UINT32_MAX) {
+                throw std::length_error("Too many tasks for ParallelFor");
+            }
+        }
+    }//namespace detail
+
+    // Вызывает func(i) для каждого i из [0, count) на threads потоках, включая вызывающий.
+    // Потоки создаются на время вызова; для многих вызовов подряд — ThreadPool.
+    // Первое исключение из func пробрасывается наружу
+    template <typename Func>
+    void ParallelFor(size_t count, size_t threads, Func func) {
+        detail::CheckTaskCount(count);
+        threads = std::max<size_t>(1, std::min(threads, count));
+        if (threads == 1) {
+            for (size_t i = 0; i < count; ++i) {
+                func(i);
+            }
+            return;
+        }
+
+        detail::StealingLoop<Func> loop(count, threads, func);
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        try {
+            for (size_t t = 1; t < threads; ++t) {
+                workers.emplace_back([&loop, t] {
+                    loop.Work(t);
+                });
+            }
+        } catch (...) {
+            //Поток не создался: уже запущенные останавливаются и присоединяются, иначе деструктор std::thread вызовет terminate
+            loop.Stop();
+            for (auto& thread : workers) {
+                thread.join();
+            }
+            throw;
+        }
+        loop.Work(0);
+        for (auto& thread : workers) {
+            thread.join();
+        }
+        loop.Rethrow();
+    }
+
+    // Постоянные потоки для многих ParallelFor подряд: потоки создаются один раз в конструкторе.
+    // Вызывающий поток работает наравне с ними. ParallelFor нельзя вызывать из заданий этого же пула
+    class ThreadPool {
+    public:
+        // threads — всего потоков вместе с вызывающим
+        explicit ThreadPool(size_t threads) {
+            const size_t workers = std::max<size_t>(threads, 1) - 1;
+            workers_.reserve(workers);
+            try {
+                for (size_t t = 1; t <= workers; ++t) {
+                    workers_.emplace_back([this, t] {
+                        WorkerLoop(t);
+                    });
+                }
+            } catch (...) {
+                StopWorkers();
+                throw;
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            StopWorkers();
+        }
+
+        size_t Size() const {
+            return workers_.size() + 1;
+        }
+
+        // Вызывает func(i) для каждого i из [0, count) на потоках пула, как parallel::ParallelFor
+        template <typename Func>
+        void ParallelFor(size_t count, Func func) {
+            detail::CheckTaskCount(count);
+            const size_t threads = std::max<size_t>(1, std::min(Size(), count));
+            if (threads == 1) {
+                for (size_t i = 0; i < count; ++i) {
+                    func(i);
+                }
+                return;
+            }
+            detail::StealingLoop<Func> loop(count, threads, func);
+            {
+                std::lock_guard guard(mutex_);
+                job_ = [&loop, threads](size_t self) {
+                    if (self < threads) {
+                        loop.Work(self);
+                    }
+                };
+                running_ = workers_.size();
+                ++generation_;
+            }
+            wake_.notify_all();
+            loop.Work(0);
+            {
+                std::unique_lock lock(mutex_);
+                done_.wait(lock, [this] {
+                    return running_ == 0;
+                });
+                job_ = nullptr;
+            }
+            loop.Rethrow();
+        }
+
+    private:
+        std::vector<std::thread> workers_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        std::function<void(size_t)> job_; // задание текущего ParallelFor, поток передаёт свой номер
+        uint64_t generation_ = 0;         // номер задания, потоки ждут следующего
+        size_t running_ = 0;              // потоки, ещё не закончившие текущее задание
+        bool stop_ = false;
+
+        void WorkerLoop(size_t self) {
+            uint64_t seen = 0;
+            while (true) {
+                {
+                    std::unique_lock lock(mutex_);
+                    wake_.wait(lock, [this, seen] {
+                        return stop_ || generation_ != seen;
+                    });
+                    if (stop_) {
+                        return;
+                    }
+                    seen = generation_;
+                }
+                //job_ не меняется, пока running_ не станет нулём
+                job_(self);
+                std::lock_guard guard(mutex_);
+                if (--running_ == 0) {
+                    done_.notify_one();
+                }
+            }
+        }
+
+        void StopWorkers() {
+            {
+                std::lock_guard guard(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto& thread : workers_) {
+                thread.join();
+            }
+        }
+    };
+
+}//namespace parallel
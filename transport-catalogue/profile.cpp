@@ -0,0 +1,234 @@
+#include "profile.h"
+
+#include "json.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace profile {
+
+    namespace {
+        //Все точки замера и счётчики процесса. Они статические, поэтому живут до конца программы
+        struct Registry {
+            std::mutex mutex;
+            std::vector<const Site*> sites;
+            std::vector<const Counter*> counters;
+            std::vector<const Histogram*> histograms;
+        };
+
+        Registry& GetRegistry() {
+            static Registry registry;
+            return registry;
+        }
+
+        double ToMilliseconds(uint64_t nanoseconds) {
+            return static_cast<double>(nanoseconds) / 1e6;
+        }
+
+        void WriteCount(json::Writer& writer, uint64_t value) {
+            //Большие значения выводятся числом с плавающей точкой, как в отчёте о памяти
+            if (value <= static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+                writer.Int(static_cast<int>(value));
+            } else {
+                writer.Double(static_cast<double>(value));
+            }
+        }
+
+        //Сумма гистограмм с одним именем
+        struct Distribution {
+            Histogram::Unit unit = Histogram::Unit::COUNT;
+            std::vector<uint64_t> buckets = std::vector<uint64_t>(Histogram::BUCKET_COUNT);
+            uint64_t count = 0;
+            uint64_t max = 0;
+
+            //Наименьшая верхняя граница корзины, до которой набирается доля quantile всех значений
+            uint64_t Quantile(double quantile) const {
+                const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count))));
+                uint64_t seen = 0;
+                for (size_t index = 0; index < buckets.size(); ++index) {
+                    seen += buckets[index];
+                    if (seen >= rank) {
+                        return std::min(Histogram::BucketUpperBound(index), max);
+                    }
+                }
+                return max;
+            }
+        };
+
+        void WriteDistribution(json::Writer& writer, const Distribution& distribution) {
+            static constexpr std::pair<std::string_view, double> QUANTILES[] = {
+                    {"p50", 0.5}, {"p99", 0.99}, {"p999", 0.999}, {"max", 1.0}};
+            const bool is_time = distribution.unit == Histogram::Unit::NANOSECONDS;
+            writer.StartDict();
+            writer.Key("count");
+            WriteCount(writer, distribution.count);
+            for (const auto& [key, quantile] : QUANTILES) {
+                const uint64_t value = quantile < 1.0 ? distribution.Quantile(quantile) : distribution.max;
+                if (is_time) {
+                    writer.Key(std::string(key) + "_ms");
+                    writer.Double(ToMilliseconds(value));
+                } else {
+                    writer.Key(key);
+                    WriteCount(writer, value);
+                }
+            }
+            writer.EndDict();
+        }
+    }//namespace
+
+    void Enable() {
+        detail::enabled.store(true, std::memory_order_relaxed);
+    }
+
+    Site::Site(std::string_view name)
+            : name_(name) {
+        Registry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.sites.push_back(this);
+    }
+
+    void Site::Record(uint64_t nanoseconds) {
+        calls_.fetch_add(1, std::memory_order_relaxed);
+        total_ns_.fetch_add(nanoseconds, std::memory_order_relaxed);
+        uint64_t max = max_ns_.load(std::memory_order_relaxed);
+        while (nanoseconds > max && !max_ns_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t Site::Calls() const {
+        return calls_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Site::TotalNanoseconds() const {
+        return total_ns_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Site::MaxNanoseconds() const {
+        return max_ns_.load(std::memory_order_relaxed);
+    }
+
+    Counter::Counter(std::string_view name)
+            : name_(name) {
+        Registry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.counters.push_back(this);
+    }
+
+    uint64_t Counter::Value() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+    Histogram::Histogram(std::string_view name, Unit unit)
+            : name_(name)
+            , unit_(unit) {
+        Registry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.histograms.push_back(this);
+    }
+
+    void Histogram::Add(uint64_t value) {
+        buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t Histogram::Max() const {
+        return max_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Histogram::BucketUpperBound(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        const size_t shift = index / SUB_BUCKETS - 1;
+        const uint64_t lower = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+        return lower + ((uint64_t{1} << shift) - 1);
+    }
+
+    void WriteReport(json::Writer& writer) {
+        struct Timing {
+            uint64_t calls = 0;
+            uint64_t total_ns = 0;
+            uint64_t max_ns = 0;
+        };
+        std::map<std::string_view, Timing> timings;
+        std::map<std::string_view, uint64_t> counters;
+        std::map<std::string_view, Distribution> distributions;
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard guard(registry.mutex);
+            for (const Site* site : registry.sites) {
+                if (site->Calls() == 0) {
+                    continue;
+                }
+                Timing& timing = timings[site->Name()];
+                timing.calls += site->Calls();
+                timing.total_ns += site->TotalNanoseconds();
+                timing.max_ns = std::max(timing.max_ns, site->MaxNanoseconds());
+            }
+            for (const Counter* counter : registry.counters) {
+                if (counter->Value() != 0) {
+                    counters[counter->Name()] += counter->Value();
+                }
+            }
+            for (const Histogram* histogram : registry.histograms) {
+                Distribution& distribution = distributions[histogram->Name()];
+                distribution.unit = histogram->GetUnit();
+                for (size_t index = 0; index < Histogram::BUCKET_COUNT; ++index) {
+                    const uint64_t count = histogram->BucketCount(index);
+                    distribution.buckets[index] += count;
+                    distribution.count += count;
+                }
+                distribution.max = std::max(distribution.max, histogram->Max());
+            }
+        }
+
+        writer.StartDict();
+        writer.Key("counters");
+        writer.StartDict();
+        for (const auto& [name, value] : counters) {
+            writer.Key(name);
+            WriteCount(writer, value);
+        }
+        writer.EndDict();
+        writer.Key("histograms");
+        writer.StartDict();
+        for (const auto& [name, distribution] : distributions) {
+            if (distribution.count != 0) {
+                writer.Key(name);
+                WriteDistribution(writer, distribution);
+            }
+        }
+        writer.EndDict();
+        writer.Key("timers");
+        writer.StartDict();
+        for (const auto& [name, timing] : timings) {
+            writer.Key(name);
+            writer.StartDict();
+            writer.Key("calls");
+            WriteCount(writer, timing.calls);
+            writer.Key("max_ms");
+            writer.Double(ToMilliseconds(timing.max_ns));
+            writer.Key("total_ms");
+            writer.Double(ToMilliseconds(timing.total_ns));
+            writer.EndDict();
+        }
+        writer.EndDict();
+        writer.EndDict();
+    }
+
+    void PrintReport(std::ostream& out) {
+        json::Writer writer(out);
+        WriteReport(writer);
+        writer.Flush();
+        out << std::endl;
+    }
+
+}//namespace profile
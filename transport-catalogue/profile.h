@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+namespace json {
+    class Writer;
+}//namespace json
+
+// Лёгкая инструментовка: таймеры областей и счётчики, которые включаются флагом --profile.
+// Точка замера — статическая переменная в месте замера, накопление — атомарные операции без блокировок.
+// Пока сбор выключен, таймер и счётчик обходятся одной проверкой флага без обращения к часам
+namespace profile {
+
+    namespace detail {
+        inline std::atomic<bool> enabled{false};
+    }//namespace detail
+
+    // Включает сбор. Вызывается до начала работы
+    void Enable();
+
+    inline bool IsEnabled() {
+        return detail::enabled.load(std::memory_order_relaxed);
+    }
+
+    // Точка замера: число вызовов, суммарное и наибольшее время
+    class Site {
+    public:
+        // name — строка со статическим временем жизни
+        explicit Site(std::string_view name);
+
+        Site(const Site&) = delete;
+        Site& operator=(const Site&) = delete;
+
+        void Record(uint64_t nanoseconds);
+
+        std::string_view Name() const {
+            return name_;
+        }
+        uint64_t Calls() const;
+        uint64_t TotalNanoseconds() const;
+        uint64_t MaxNanoseconds() const;
+
+    private:
+        std::string_view name_;
+        std::atomic<uint64_t> calls_{0};
+        std::atomic<uint64_t> total_ns_{0};
+        std::atomic<uint64_t> max_ns_{0};
+    };
+
+    // Замеряет время от создания до разрушения и добавляет его в site
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Site& site)
+                : site_(IsEnabled() ? &site : nullptr) {
+            if (site_) {
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        ~ScopedTimer() {
+            if (site_) {
+                const auto elapsed = std::chrono::steady_clock::now() - start_;
+                site_->Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        }
+
+    private:
+        Site* site_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // Счётчик: сумма добавленных значений
+    class Counter {
+    public:
+        // name — строка со статическим временем жизни
+        explicit Counter(std::string_view name);
+
+        Counter(const Counter&) = delete;
+        Counter& operator=(const Counter&) = delete;
+
+        void Add(uint64_t value = 1) {
+            if (IsEnabled()) {
+                value_.fetch_add(value, std::memory_order_relaxed);
+            }
+        }
+
+        std::string_view Name() const {
+            return name_;
+        }
+        uint64_t Value() const;
+
+    private:
+        std::string_view name_;
+        std::atomic<uint64_t> value_{0};
+    };
+
+    // Распределение значений с логарифмическими корзинами, как в HdrHistogram: каждая степень двойки
+    // делится на SUB_BUCKETS равных частей, поэтому относительная погрешность квантиля не больше 1/SUB_BUCKETS
+    // при любом разбросе значений — от наносекундного поиска до многосекундной отрисовки
+    class Histogram {
+    public:
+        enum class Unit {
+            NANOSECONDS, // длительности; в отчёте — миллисекунды
+            COUNT,       // безразмерные величины, например число рёбер пути
+        };
+
+        static constexpr int SUB_BUCKET_BITS = 4;
+        static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+        static constexpr size_t BUCKET_COUNT = SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1);
+
+        // name — строка со статическим временем жизни
+        explicit Histogram(std::string_view name, Unit unit = Unit::NANOSECONDS);
+
+        Histogram(const Histogram&) = delete;
+        Histogram& operator=(const Histogram&) = delete;
+
+        void Record(uint64_t value) {
+            if (IsEnabled()) {
+                Add(value);
+            }
+        }
+
+        std::string_view Name() const {
+            return name_;
+        }
+        Unit GetUnit() const {
+            return unit_;
+        }
+        uint64_t BucketCount(size_t index) const {
+            return buckets_[index].load(std::memory_order_relaxed);
+        }
+        uint64_t Max() const;
+
+        // Номер корзины значения: младшие SUB_BUCKETS значений — по одному в корзине,
+        // дальше старший бит задаёт степень, следующие SUB_BUCKET_BITS бит — часть внутри неё
+        static size_t BucketIndex(uint64_t value) {
+            if (value < SUB_BUCKETS) {
+                return static_cast<size_t>(value);
+            }
+            int magnitude = 63;
+            while (!(value >> magnitude)) {
+                --magnitude;
+            }
+            const int shift = magnitude - SUB_BUCKET_BITS;
+            return static_cast<size_t>(SUB_BUCKETS * (shift + 1) + ((value >> shift) - SUB_BUCKETS));
+        }
+        // Наибольшее значение, попадающее в корзину
+        static uint64_t BucketUpperBound(size_t index);
+
+    private:
+        std::string_view name_;
+        Unit unit_;
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+        std::atomic<uint64_t> max_{0};
+
+        void Add(uint64_t value);
+    };
+
+    // Замеряет время от создания до разрушения и записывает его в histogram
+    class ScopedLatency {
+    public:
+        explicit ScopedLatency(Histogram& histogram)
+                : histogram_(IsEnabled() ? &histogram : nullptr) {
+            if (histogram_) {
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        ScopedLatency(const ScopedLatency&) = delete;
+        ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+        ~ScopedLatency() {
+            if (histogram_) {
+                const auto elapsed = std::chrono::steady_clock::now() - start_;
+                histogram_->Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        }
+
+    private:
+        Histogram* histogram_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // Сводка в формате JSON: {"counters": {имя: значение}, "histograms": {имя: {"count", "p50", "p99", "p999", "max"}},
+    // "timers": {имя: {"calls", "total_ms", "max_ms"}}}. У гистограмм длительностей к ключам квантилей добавляется "_ms".
+    // Квантиль — верхняя граница корзины, в которую он попал, но не больше наибольшего значения.
+    // Точки с одинаковыми именами складываются, не сработавшие ни разу пропускаются
+    void WriteReport(json::Writer& writer);
+    // WriteReport в читаемом виде с переводом строки в конце
+    void PrintReport(std::ostream& out);
+
+}//namespace profile
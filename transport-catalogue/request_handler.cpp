@@ -1,59 +1,148 @@
 #include "request_handler.h"
+#include "profile.h"
 
+#include <algorithm>
+#include <iterator>
 #include <utility>
 
 namespace request_handler {
 using namespace std::string_literals;
 
+    namespace {
+        //Гистограммы задержки по типам запросов, в порядке альтернатив StatRequest::query
+        profile::Histogram& LatencyHistogram(const StatRequest& request) {
+            static profile::Histogram histograms[] = {
+                    profile::Histogram("request.Bus"),
+                    profile::Histogram("request.Stop"),
+                    profile::Histogram("request.Route"),
+                    profile::Histogram("request.Map"),
+                    profile::Histogram("request.Tile"),
+                    profile::Histogram("request.RouteMap"),
+            };
+            static_assert(std::size(histograms) == std::variant_size_v<decltype(StatRequest::query)>);
+            return histograms[request.query.index()];
+        }
+    }//namespace
+
     RequestHandler::RequestHandler(const RequestHandler::TransportCatalogue &db,
-                                   const std::vector<std::pair<int, std::string>> &requests,
-                                   RendererSettings renderer_settings, const TransportRouter& router)
+                                   RendererSettings renderer_settings, const TransportRouter& router,
+                                   size_t threads)
     : db_(db)
-    , requests_(requests)
     , renderer_settings_(std::move(renderer_settings))
-    , router_(router){
-        for(auto& [id, request] : requests_){
-            auto space = request.find_first_of(' ');
-            if(request.substr(0, space) == "Bus"s){
-                answers_.emplace_back(id, GetBusStat(request.substr(space)));
-            }
-            else if(request.substr(0, space) == "Stop"s){
-                answers_.emplace_back(id, GetBusesByStop(request.substr(space)));
+    , router_(router)
+    , threads_(std::max<size_t>(threads, 1)){
+    }
+
+    RequestHandler::Answer RequestHandler::ProcessRequest(const StatRequest& request) const {
+        return ProcessRequest(request, threads_);
+    }
+
+    RequestHandler::Answer RequestHandler::ProcessRequest(const StatRequest& request, size_t threads) const {
+        if (!request.is_resolved) {
+            StatRequest resolved = request;
+            db_.Resolve(resolved);
+            return ProcessRequest(resolved, threads);
+        }
+        static profile::Counter processed("requests.processed");
+        processed.Add();
+        const profile::ScopedLatency latency(LatencyHistogram(request));
+        if (const auto* query = std::get_if<BusQuery>(&request.query)) {
+            return query->bus ? db_.RouteInformation(*query->bus) : BusRoute{};
+        }
+        if (const auto* query = std::get_if<StopQuery>(&request.query)) {
+            return query->stop ? db_.StopInformation(*query->stop) : StopRoutes{};
+        }
+        if (const auto* query = std::get_if<RouteQuery>(&request.query)) {
+            if (!query->from_stop || !query->to_stop) {
+                return BusTripRoute{};
             }
-            else if(request.substr(0, space) == "Map"s){
-                MapRenderer map_renderer(renderer_settings_, GetActiveBuses());
-                answers_.emplace_back(id, map_renderer.RenderMap());
+            return router_.GetRoute(*query->from_stop, *query->to_stop);
+        }
+        if (const auto* query = std::get_if<TileQuery>(&request.query)) {
+            return tile_cache_.Get(db_.Version(), renderer_settings_, *query,
+                                   [this] {
+                                       return std::make_unique<MapTiles>(renderer_settings_, GetActiveBuses());
+                                   },
+                                   [this, query](const MapTiles& tiles) {
+                                       return RenderEscaped(tiles.RenderTile(*query), 1);
+                                   });
+        }
+        if (const auto* query = std::get_if<RouteMapQuery>(&request.query)) {
+            if (!query->route.from_stop || !query->route.to_stop) {
+                return RenderedMap{};
             }
-            else if(request.substr(0, space) == "Route"s){
-                auto separator = request.find(" -> ", ++space);
-                std::string first_stop = request.substr(space, (separator - space));
-                std::string last_stop = request.substr(separator + 4);
-                answers_.emplace_back(id, router_.GetRoute(first_stop, last_stop));
+            const BusTripRoute route = router_.GetRoute(*query->route.from_stop, *query->route.to_stop);
+            if (!route.is_found) {
+                return RenderedMap{};
             }
+            //Готовый текст карты не перестраивается и не копируется: слой маршрута выводится перед его закрывающим тегом
+            const MapCache::Entry map = GetMap(threads);
+            return RenderedMap{map.map.escaped_svg, RenderOverlayEscaped(map.scene->renderer->RenderRouteOverlay(route))};
         }
+        return GetMap(threads).map;
     }
 
-    // Возвращает информацию о маршруте (запрос Bus)
-    BusRoute RequestHandler::GetBusStat(const std::string_view &bus_name) const {
-        return db_.RouteInformation(bus_name);
+    MapCache::Entry RequestHandler::GetMap(size_t threads) const {
+        //Карта целиком строится один раз на версию справочника, остальные запросы с картой ждут её,
+        //поэтому отрисовка занимает все потоки, отведённые обработке
+        return map_cache_.Get(db_.Version(), renderer_settings_,
+                              [this, threads] {
+                                  auto renderer = std::make_unique<MapRenderer>(renderer_settings_, GetActiveBuses());
+                                  svg::FlatDocument doc = renderer->RenderMap(threads);
+                                  static profile::Counter objects("map.objects");
+                                  objects.Add(doc.ObjectCount());
+                                  return MapScene{std::move(renderer), std::move(doc)};
+                              },
+                              [this, threads](const svg::FlatDocument& scene) {
+                                  return RenderEscaped(scene, threads);
+                              });
     }
-    // Возвращает маршруты, проходящие через остановку (запрос Stop)
-    StopRoutes RequestHandler::GetBusesByStop(const std::string_view &stop_name) const {
-        return db_.StopInformation(stop_name);
+
+    std::string RequestHandler::RenderOverlayEscaped(const svg::FlatDocument& overlay) const {
+        std::string escaped_overlay;
+        json::EscapingBuffer buffer(escaped_overlay);
+        std::ostream out(&buffer);
+        overlay.RenderOverlay(out, renderer_settings_.svg_output);
+        return escaped_overlay;
     }
-    //Возвращает словарь ответов
-    const std::vector<std::pair<int, std::variant<BusRoute, StopRoutes, svg::Document, BusTripRoute>>>& RequestHandler::GetAnswers() const{
-        return answers_;
+
+    std::string RequestHandler::RenderEscaped(const svg::FlatDocument& doc, size_t threads) const {
+        static profile::Site site("map.serialize");
+        const profile::ScopedTimer timer(site);
+        std::string escaped_svg;
+        json::EscapingBuffer buffer(escaped_svg);
+        std::ostream out(&buffer);
+        doc.Render(out, renderer_settings_.svg_output, threads);
+        return escaped_svg;
     }
-    //Возвращает список непустых маршрутов
-    std::map<std::string_view, std::shared_ptr<Bus>> RequestHandler::GetActiveBuses(){
-        std::map<std::string_view, std::shared_ptr<Bus>> active_buses;
-        for(const auto&[name, bus] : db_.GetBuses()){
-            if(!bus.route.empty()){
-                active_buses.insert({name, std::make_shared<Bus>(bus)});
+
+    void RequestHandler::ProcessRequests(const std::vector<StatRequest> &requests, size_t threads,
+                                         const std::function<void(int, const Answer &)> &sink) const {
+        //Порция достаточно велика, чтобы потокам хватало работы, и не зависит от размера пакета.
+        //Потоки создаются один раз на весь пакет, порции обрабатываются ими по очереди
+        const size_t chunk_size = std::max<size_t>(threads, 1) * 64;
+        parallel::ThreadPool pool(std::min(threads, requests.size()));
+        std::vector<Answer> answers;
+        for (size_t chunk_begin = 0; chunk_begin < requests.size(); chunk_begin += chunk_size) {
+            const size_t chunk_end = std::min(requests.size(), chunk_begin + chunk_size);
+            answers.clear();
+            answers.resize(chunk_end - chunk_begin);
+            //Запросы порции уже заняли все потоки, поэтому карта внутри них рисуется в одном потоке:
+            //иначе каждый поток пула запустил бы ещё threads своих. Порция из одного запроса
+            //выполняется вызывающим потоком, и её карте достаются все потоки
+            const size_t render_threads = answers.size() == 1 ? threads : 1;
+            pool.ParallelFor(answers.size(), [this, &requests, &answers, chunk_begin, render_threads](size_t index) {
+                answers[index] = ProcessRequest(requests[chunk_begin + index], render_threads);
+            });
+            for (size_t i = 0; i < answers.size(); ++i) {
+                sink(requests[chunk_begin + i].id, answers[i]);
             }
         }
-        return active_buses;
+    }
+
+    //Возвращает список непустых маршрутов
+    std::map<std::string_view, const Bus*> RequestHandler::GetActiveBuses() const{
+        return db_.GetActiveBuses();
     }
 
 
@@ -1,37 +1,51 @@
 #pragma once
 #include "transport_catalogue.h"
 #include "json_reader.h"
+#include "parallel.h"
 #include <variant>
+#include <functional>
 #include <memory>
 
 namespace request_handler {
     class RequestHandler {
     public:
         using TransportCatalogue = transport_catalogue::TransportCatalogue;
+        using Answer = std::variant<BusRoute, StopRoutes, RenderedMap, BusTripRoute>;
 
-        RequestHandler(const TransportCatalogue &db, const std::vector<std::pair<int, std::string>>& requests);
-        RequestHandler(const TransportCatalogue &db, const std::vector<std::pair<int, std::string>>& requests, RendererSettings renderer_settings, const TransportRouter& router);
+        //Справочник и маршрутизатор не копируются и должны жить дольше обработчика.
+        //threads — сколько потоков может занять отрисовка карты в одном запросе
+        RequestHandler(const TransportCatalogue &db, RendererSettings renderer_settings, const TransportRouter& router,
+                       size_t threads = parallel::DefaultThreadCount());
 
-        // Возвращает информацию о маршруте (запрос Bus)
-        BusRoute GetBusStat(const std::string_view &bus_name) const;
+        //Ответ на один запрос. Неразрешённые названия в запросе разрешаются по справочнику.
+        //Не изменяет состояние, поэтому может вызываться из нескольких потоков
+        Answer ProcessRequest(const StatRequest& request) const;
 
-        // Возвращает маршруты, проходящие через
-        StopRoutes GetBusesByStop(const std::string_view &stop_name) const;
-
-        //Возвращает словарь ответов
-        const std::vector<std::pair<int, std::variant<BusRoute, StopRoutes, svg::Document, BusTripRoute>>>& GetAnswers() const;
+        //Обрабатывает пакет запросов параллельно порциями и передаёт ответы в sink в порядке запросов.
+        //В памяти одновременно находится не больше одной порции ответов.
+        //Потоки не вкладываются: карта, которую рисует поток пакета, рисуется в одном потоке
+        void ProcessRequests(const std::vector<StatRequest>& requests, size_t threads,
+                             const std::function<void(int, const Answer&)>& sink) const;
 
         //Возвращает список непустых маршрутов
-        std::map<std::string_view, std::shared_ptr<Bus>> GetActiveBuses();
-
-        //Загружает объект MapRenderer
-
+        std::map<std::string_view, const Bus*> GetActiveBuses() const;
 
     private:
+
         const TransportCatalogue &db_;
-        const std::vector<std::pair<int, std::string>>& requests_;
-        std::vector<std::pair<int, std::variant<BusRoute, StopRoutes, svg::Document, BusTripRoute>>> answers_;
         RendererSettings renderer_settings_;
-        TransportRouter router_;
+        const TransportRouter& router_;
+        MapCache map_cache_;
+        TileCache tile_cache_;
+        size_t threads_;
+
+        //Ответ на один запрос, отрисовка карты занимает не больше threads потоков
+        Answer ProcessRequest(const StatRequest& request, size_t threads) const;
+        //Карта целиком из кэша вместе с её сценой
+        MapCache::Entry GetMap(size_t threads) const;
+        //SVG выводится сразу в экранированном для JSON виде, без промежуточной строки
+        std::string RenderEscaped(const svg::FlatDocument& doc, size_t threads) const;
+        //Экранированный слой overlay для вывода поверх готовой карты из кэша
+        std::string RenderOverlayEscaped(const svg::FlatDocument& overlay) const;
     };
 }//namespace request_handler
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "graph.h"
+#include "profile.h"
 
 #include <algorithm>
 #include <cassert>
@@ -29,6 +30,15 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // Динамическая память таблицы предподсчитанных маршрутов
+    memory::Usage MemoryUsage() const {
+        memory::Usage usage = memory::Heap(routes_internal_data_);
+        for (const auto& row : routes_internal_data_) {
+            usage += memory::Heap(row);
+        }
+        return usage;
+    }
+
 private:
     struct RouteInternalData {
         Weight weight;
@@ -86,6 +96,8 @@ Router<Weight>::Router(const Graph& graph)
     , routes_internal_data_(graph.GetVertexCount(),
                             std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
 {
+    static profile::Site site("router.precompute");
+    const profile::ScopedTimer timer(site);
     InitializeRoutesInternalData(graph);
 
     const size_t vertex_count = graph.GetVertexCount();
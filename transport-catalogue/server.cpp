@@ -0,0 +1,222 @@
+#include "server.h"
+#include "answer_writer.h"
+#include "json_arena.h"
+#include "json_builder.h"
+#include "profile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace server {
+    using namespace std::string_literals;
+
+    namespace {
+        //Наибольшая длина строки запроса от клиента сокета; строка длиннее считается ошибкой клиента
+        constexpr size_t MAX_LINE_SIZE = 1 << 20;
+
+        //Строка ответа: write выводит одно значение в компактном виде, дерево не строится
+        template <typename Write>
+        std::string ToLine(Write write) {
+            std::ostringstream out;
+            json::Writer writer(out, json::Writer::Format::COMPACT);
+            write(writer);
+            writer.Flush();
+            out << '\n';
+            return out.str();
+        }
+
+        //request_id выводится, если его удалось прочитать из запроса
+        std::string ErrorLine(const std::string& message, std::optional<int> request_id = std::nullopt) {
+            return ToLine([&message, request_id](json::Writer& writer) {
+                json::Builder builder(writer);
+                builder.StartDict().Key("error_message"s).Value(message);
+                if (request_id) {
+                    builder.Key("request_id"s).Value(*request_id);
+                }
+                builder.EndDict().Finish();
+            });
+        }
+
+        //Отключившийся клиент не должен завершать сервер сигналом SIGPIPE: send с MSG_NOSIGNAL
+        //возвращает EPIPE или ECONNRESET, и закрывается только соединение этого клиента
+        bool WriteAll(int fd, const std::string& data) {
+            size_t written = 0;
+            while (written < data.size()) {
+                const ssize_t result = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+                if (result < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (result <= 0) {
+                    return false;
+                }
+                written += static_cast<size_t>(result);
+            }
+            return true;
+        }
+
+        //Построчное чтение из сокета клиента
+        void ServeClient(Server& server, int client_fd) {
+            std::string buffer;
+            char chunk[4096];
+            while (true) {
+                const ssize_t received = ::read(client_fd, chunk, sizeof(chunk));
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (received <= 0) {
+                    break;
+                }
+                buffer.append(chunk, static_cast<size_t>(received));
+                size_t line_begin = 0;
+                for (size_t line_end; (line_end = buffer.find('\n', line_begin)) != std::string::npos;
+                     line_begin = line_end + 1) {
+                    if (!WriteAll(client_fd, server.HandleLine(buffer.substr(line_begin, line_end - line_begin)))) {
+                        ::close(client_fd);
+                        return;
+                    }
+                }
+                buffer.erase(0, line_begin);
+                if (buffer.size() > MAX_LINE_SIZE) {
+                    WriteAll(client_fd, ErrorLine("request line is too long"s));
+                    break;
+                }
+            }
+            ::close(client_fd);
+        }
+    }//namespace
+
+    namespace {
+        json_reader::JsonReader ReadBase(std::string_view text, transport_catalogue::TransportCatalogue& catalogue) {
+            json::Cursor cursor(text);
+            return json_reader::JsonReader(cursor, catalogue);
+        }
+    }//namespace
+
+    Server::State::State(std::string_view text)
+            : reader(ReadBase(text, catalogue))
+            , router(catalogue, reader.RouterSettingsReturn())
+            , handler(catalogue, reader.RenderSettingsReturn(), router) {
+    }
+
+    Server::Server(std::string base_path)
+            : base_path_(std::move(base_path))
+            , state_(LoadState()) {
+    }
+
+    std::shared_ptr<const Server::State> Server::LoadState() const {
+        std::ifstream base_file(base_path_, std::ios::binary);
+        if (!base_file) {
+            throw std::invalid_argument("Can't open " + base_path_);
+        }
+        const std::string text{std::istreambuf_iterator<char>(base_file), std::istreambuf_iterator<char>()};
+        return std::make_shared<const State>(text);
+    }
+
+    void Server::Reload() {
+        static profile::Site site("server.reload");
+        const profile::ScopedTimer timer(site);
+        //Новое состояние строится без блокировки запросов, подменяется атомарно
+        std::lock_guard guard(reload_mutex_);
+        std::atomic_store(&state_, LoadState());
+    }
+
+    std::string Server::HandleLine(const std::string& line) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            return {};
+        }
+        std::optional<int> request_id;
+        try {
+            //Тип и id команды берутся из компактного представления строки
+            const json::arena::Document document(line);
+            const auto& query = document.GetRoot();
+            const json::arena::Value* type = query.IsMap() ? query.AsMap().Find("type") : nullptr;
+            if (const json::arena::Value* id = query.IsMap() ? query.AsMap().Find("id") : nullptr; id && id->IsInt()) {
+                request_id = id->AsInt();
+            }
+            if (type && type->IsString() && type->AsString() == "Reload") {
+                Reload();
+                return ToLine([&request_id](json::Writer& writer) {
+                    json::Builder builder(writer);
+                    builder.StartDict();
+                    if (request_id) {
+                        builder.Key("request_id"s).Value(*request_id);
+                    }
+                    builder.Key("status"s).Value("reloaded"s).EndDict().Finish();
+                });
+            }
+            if (type && type->IsString() && type->AsString() == "Stats") {
+                //Сводка --profile на текущий момент: без флага профилирования она пустая
+                return ToLine([&request_id](json::Writer& writer) {
+                    writer.StartDict();
+                    if (request_id) {
+                        writer.Key("request_id");
+                        writer.Int(*request_id);
+                    }
+                    writer.Key("stats");
+                    profile::WriteReport(writer);
+                    writer.EndDict();
+                });
+            }
+
+            const std::shared_ptr<const State> state = std::atomic_load(&state_);
+            //Сам запрос читается тем же курсором, что и элементы stat_requests во входном документе
+            json::Cursor cursor(line);
+            const auto request = state->reader.ReadStatRequest(cursor, &state->catalogue);
+            cursor.Finish();
+            if (!request) {
+                return ErrorLine("unknown request type"s, request_id);
+            }
+            const auto answer = state->handler.ProcessRequest(*request);
+            return ToLine([&state, &request, &answer](json::Writer& writer) {
+                json_reader::WriteAnswer(writer, state->reader.RouterSettingsReturn(), request->id, answer);
+            });
+        } catch (const std::exception& e) {
+            return ErrorLine(e.what(), request_id);
+        }
+    }
+
+    void Server::Serve(std::istream& input, std::ostream& output) {
+        for (std::string line; std::getline(input, line);) {
+            output << HandleLine(line) << std::flush;
+        }
+    }
+
+    void Server::ServeUnixSocket(const std::string& socket_path) {
+        sockaddr_un address{};
+        if (socket_path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Socket path is too long: " + socket_path);
+        }
+        const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0) {
+            throw std::runtime_error("Can't create socket: "s + std::strerror(errno));
+        }
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+        ::unlink(socket_path.c_str());
+        if (::bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+            || ::listen(listen_fd, SOMAXCONN) != 0) {
+            ::close(listen_fd);
+            throw std::runtime_error("Can't listen on " + socket_path + ": " + std::strerror(errno));
+        }
+        while (true) {
+            const int client_fd = ::accept(listen_fd, nullptr, nullptr);
+            if (client_fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                ::close(listen_fd);
+                throw std::runtime_error("accept failed: "s + std::strerror(errno));
+            }
+            std::thread(ServeClient, std::ref(*this), client_fd).detach();
+        }
+    }
+
+}//namespace server
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "request_handler.h"
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace server {
+
+    // Долгоживущий режим: база загружается один раз, затем запросы принимаются построчно (NDJSON).
+    // Каждая строка — один объект запроса в формате элемента stat_requests, ответ — одна строка JSON.
+    // Команда {"type": "Reload"} перечитывает файл базы; запросы, начатые до перезагрузки,
+    // дорабатывают на старых данных. Команда {"type": "Stats"} возвращает сводку --profile
+    class Server {
+    public:
+        // base_path — JSON с base_requests, render_settings и routing_settings
+        explicit Server(std::string base_path);
+
+        // Обслуживает один поток строк до его конца
+        void Serve(std::istream& input, std::ostream& output);
+
+        // Принимает клиентов на Unix-сокете, каждый клиент обслуживается в своём потоке
+        void ServeUnixSocket(const std::string& socket_path);
+
+        // Ответ на одну строку запроса
+        std::string HandleLine(const std::string& line);
+
+    private:
+        // Всё, что строится по файлу базы. Маршрутизатор и обработчик ссылаются на справочник,
+        // обработчик — на маршрутизатор, поэтому состояние создаётся целиком и не перемещается
+        struct State {
+            explicit State(std::string_view text);
+
+            transport_catalogue::TransportCatalogue catalogue;
+            json_reader::JsonReader reader;
+            TransportRouter router;
+            request_handler::RequestHandler handler;
+        };
+
+        std::string base_path_;
+        std::shared_ptr<const State> state_;
+        std::mutex reload_mutex_;
+
+        std::shared_ptr<const State> LoadState() const;
+        void Reload();
+    };
+
+}//namespace server
@@ -0,0 +1,125 @@
+#include "stream_pipeline.h"
+#include "request_handler.h"
+#include "answer_writer.h"
+
+#include <optional>
+
+namespace stream_pipeline {
+    namespace {
+        using transport_catalogue::TransportCatalogue;
+
+        class Pipeline {
+        public:
+            Pipeline(std::istream& input, std::ostream& output)
+                    : reader_(input)
+                    , output_(output) {
+            }
+
+            void Run() {
+                using namespace std::string_literals;
+                reader_.BeginObject();
+                std::string key;
+                while (reader_.NextKey(key)) {
+                    if (key == "base_requests"s) {
+                        ReadBaseRequests();
+                    }
+                    else if (key == "stat_requests"s) {
+                        ReadStatRequests();
+                    }
+                    else if (key == "render_settings"s) {
+                        json_reader_.JsonRenderSettingsReader(reader_.ReadValue().AsMap());
+                        has_render_settings_ = true;
+                    }
+                    else if (key == "routing_settings"s) {
+                        json_reader_.JsonRouterSettingsReader(reader_.ReadValue().AsMap());
+                        has_routing_settings_ = true;
+                    }
+                    else {
+                        reader_.ReadValue();
+                    }
+                }
+                reader_.Finish();
+                if (!IsReady()) {
+                    throw std::invalid_argument("Incorrect JSON");
+                }
+                for (auto& request : pending_requests_) {
+                    catalogue_.Resolve(request);
+                    Answer(request);
+                }
+                writer().Finish();
+            }
+
+        private:
+            json::StreamReader reader_;
+            std::ostream& output_;
+            json_reader::JsonReader json_reader_;
+            TransportCatalogue catalogue_;
+            std::optional<TransportRouter> router_;
+            std::optional<request_handler::RequestHandler> handler_;
+
+            std::vector<StatRequest> pending_requests_;
+
+            bool has_base_ = false;
+            bool has_render_settings_ = false;
+            bool has_routing_settings_ = false;
+            std::optional<json_reader::AnswerWriter> writer_;
+
+            //Создаётся после чтения routing_settings, от которых зависит формат ответов на Route
+            json_reader::AnswerWriter& writer() {
+                if (!writer_) {
+                    writer_.emplace(output_, json_reader_.RouterSettingsReturn());
+                }
+                return *writer_;
+            }
+
+            bool IsReady() const {
+                return has_base_ && has_render_settings_ && has_routing_settings_;
+            }
+
+            void ReadBaseRequests() {
+                json_reader::CatalogueLoader loader(catalogue_);
+                reader_.BeginArray();
+                while (reader_.NextElement()) {
+                    reader_.ReadValue([&loader](json::Cursor& cursor) {
+                        json_reader::JsonReader::ReadBaseRequest(cursor, loader);
+                    });
+                }
+                loader.Finish();
+                has_base_ = true;
+            }
+
+            void ReadStatRequests() {
+                reader_.BeginArray();
+                while (reader_.NextElement()) {
+                    std::optional<StatRequest> request;
+                    reader_.ReadValue([this, &request](json::Cursor& cursor) {
+                        request = json_reader_.ReadStatRequest(cursor, IsReady() ? &catalogue_ : nullptr);
+                    });
+                    if (!request) {
+                        continue;
+                    }
+                    if (IsReady()) {
+                        Answer(*request);
+                    }
+                    else {
+                        pending_requests_.push_back(std::move(*request));
+                    }
+                }
+            }
+
+            void Answer(const StatRequest& request) {
+                if (!handler_) {
+                    router_.emplace(catalogue_, json_reader_.RouterSettingsReturn());
+                    handler_.emplace(catalogue_, json_reader_.RenderSettingsReturn(), *router_);
+                }
+                writer().Write(request.id, handler_->ProcessRequest(request));
+                writer().Flush();
+            }
+        };
+    }//namespace
+
+    void Run(std::istream& input, std::ostream& output) {
+        Pipeline(input, output).Run();
+    }
+
+}//namespace stream_pipeline
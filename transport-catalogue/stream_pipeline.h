@@ -0,0 +1,15 @@
+#pragma once
+
+#include <iostream>
+
+namespace stream_pipeline {
+
+    // Потоковая обработка входного документа.
+    // Элементы base_requests добавляются в справочник по мере разбора, каждый элемент stat_requests
+    // разбирается, обрабатывается и печатается до чтения следующего, поэтому память не зависит
+    // от размера пакета запросов и первые ответы выводятся сразу.
+    // Если stat_requests во входе идут раньше базы или настроек, они накапливаются до конца документа.
+    // Вывод совпадает с обычным режимом
+    void Run(std::istream& input, std::ostream& output);
+
+}//namespace stream_pipeline
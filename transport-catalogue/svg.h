@@ -4,6 +4,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <variant>
@@ -20,6 +21,10 @@ namespace svg {
         double y = 0.0;
     };
 
+    inline bool operator==(const Point& lhs, const Point& rhs) {
+        return lhs.x == rhs.x && lhs.y == rhs.y;
+    }
+
 
     struct RenderContext {
         RenderContext(std::ostream& out)
@@ -100,6 +105,14 @@ namespace svg {
         double opacity  = 1.0;
     };
 
+    inline bool operator==(const Rgb& lhs, const Rgb& rhs) {
+        return lhs.red == rhs.red && lhs.green == rhs.green && lhs.blue == rhs.blue;
+    }
+
+    inline bool operator==(const Rgba& lhs, const Rgba& rhs) {
+        return lhs.red == rhs.red && lhs.green == rhs.green && lhs.blue == rhs.blue && lhs.opacity == rhs.opacity;
+    }
+
     using Color = std::variant<std::monostate, std::string, svg::Rgb, svg::Rgba>;
     inline const std::string NoneColor{"none"};
 
@@ -164,6 +177,13 @@ namespace svg {
             stroke_line_join_ = line_join;
             return AsOwner();
         }
+
+        const std::optional<Color>& GetFillColor() const {
+            return fill_color_;
+        }
+        const std::optional<Color>& GetStrokeColor() const {
+            return stroke_color_;
+        }
     protected:
         ~PathProps() = default;
 
@@ -186,6 +206,33 @@ namespace svg {
                 out << " stroke-linejoin=\"" << *stroke_line_join_ << "\""sv;
             }
         }
+
+        // Те же свойства в виде объявлений CSS (fill:...;stroke:...)
+        void RenderCss(std::ostream& out) const {
+            using namespace std::literals;
+
+            std::string_view separator;
+            auto property = [&out, &separator](std::string_view name) -> std::ostream& {
+                out << separator << name << ':';
+                separator = ";"sv;
+                return out;
+            };
+            if (fill_color_) {
+                property("fill"sv) << *fill_color_;
+            }
+            if (stroke_color_) {
+                property("stroke"sv) << *stroke_color_;
+            }
+            if (stroke_width_) {
+                property("stroke-width"sv) << *stroke_width_ << "px"sv;
+            }
+            if (stroke_line_cap_) {
+                property("stroke-linecap"sv) << *stroke_line_cap_;
+            }
+            if (stroke_line_join_) {
+                property("stroke-linejoin"sv) << *stroke_line_join_;
+            }
+        }
     private:
         Owner& AsOwner() {
             // static_cast безопасно преобразует *  this к Owner&,
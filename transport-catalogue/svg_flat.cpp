@@ -0,0 +1,675 @@
+#include "svg_flat.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+#include <stdexcept>
+
+namespace svg {
+
+    using namespace std::literals;
+
+    namespace {
+        //Накопленный вывод передаётся в поток кусками такого размера
+        constexpr size_t FLUSH_THRESHOLD = 1 << 16;
+
+        constexpr uint64_t POWERS_OF_TEN[MAX_PRECISION + 1] = {
+                1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+        //Координаты дальше этого предела (и не-числа) в компактном режиме выводятся как 0,
+        //чтобы округлённое значение помещалось в int64_t
+        constexpr double MAX_SCALED = 1e18;
+
+        //Порции параллельного вывода: не меньше MIN_CHUNK_SIZE команд, по несколько на поток
+        constexpr size_t MIN_CHUNK_SIZE = 1024;
+        constexpr size_t CHUNKS_PER_THREAD = 4;
+
+        // Буфер вывода с быстрым форматированием чисел. Без потока весь вывод остаётся в буфере
+        class Serializer {
+        public:
+            explicit Serializer(std::ostream* out = nullptr)
+                    : out_(out) {
+                buffer_.reserve(FLUSH_THRESHOLD * 2);
+            }
+
+            ~Serializer() {
+                Flush();
+            }
+
+            Serializer& operator<<(std::string_view text) {
+                buffer_ += text;
+                return *this;
+            }
+
+            Serializer& operator<<(char c) {
+                buffer_ += c;
+                return *this;
+            }
+
+            //Кратчайшая точная запись
+            void AppendShortest(double value) {
+                char digits[32];
+                const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+                buffer_.append(digits, result.ptr);
+            }
+
+            //Формат %g с точностью 6 — как у std::ostream по умолчанию
+            Serializer& operator<<(double value) {
+                char digits[32];
+                const auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+                buffer_.append(digits, result.ptr);
+                return *this;
+            }
+
+            Serializer& operator<<(uint32_t value) {
+                char digits[16];
+                const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+                buffer_.append(digits, result.ptr);
+                return *this;
+            }
+
+            // Число, округлённое до целого количества единиц 10^-precision: дробная часть без хвостовых нулей
+            void AppendFixed(int64_t scaled, int precision) {
+                uint64_t magnitude = static_cast<uint64_t>(scaled);
+                if (scaled < 0) {
+                    buffer_ += '-';
+                    magnitude = 0 - magnitude;
+                }
+                const uint64_t scale = POWERS_OF_TEN[precision];
+                char digits[24];
+                auto result = std::to_chars(digits, digits + sizeof(digits), magnitude / scale);
+                buffer_.append(digits, result.ptr);
+                uint64_t fraction = magnitude % scale;
+                if (fraction == 0) {
+                    return;
+                }
+                int width = precision;
+                while (fraction % 10 == 0) {
+                    fraction /= 10;
+                    --width;
+                }
+                result = std::to_chars(digits, digits + sizeof(digits), fraction);
+                buffer_ += '.';
+                buffer_.append(static_cast<size_t>(width - (result.ptr - digits)), '0');
+                buffer_.append(digits, result.ptr);
+            }
+
+            void AppendXml(std::string_view data) {
+                for (const char ch : data) {
+                    switch (ch) {
+                        case '"': buffer_ += "&quot;"sv; break;
+                        case '\'': buffer_ += "&apos;"sv; break;
+                        case '<': buffer_ += "&lt;"sv; break;
+                        case '>': buffer_ += "&gt;"sv; break;
+                        case '&': buffer_ += "&amp;"sv; break;
+                        default: buffer_ += ch;
+                    }
+                }
+            }
+
+            void FlushIfFull() {
+                if (buffer_.size() >= FLUSH_THRESHOLD) {
+                    Flush();
+                }
+            }
+
+            void Flush() {
+                if (out_) {
+                    out_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+                    buffer_.clear();
+                }
+            }
+
+            // Готовый фрагмент вывода передаётся в поток напрямую, минуя буфер
+            void Write(std::string_view data) {
+                Flush();
+                if (out_) {
+                    out_->write(data.data(), static_cast<std::streamsize>(data.size()));
+                } else {
+                    buffer_ += data;
+                }
+            }
+
+            std::string& Buffer() {
+                return buffer_;
+            }
+
+        private:
+            std::ostream* out_;
+            std::string buffer_;
+        };
+
+        int64_t Scale(double value, int precision) {
+            const double scaled = std::round(value * static_cast<double>(POWERS_OF_TEN[precision]));
+            return std::abs(scaled) < MAX_SCALED ? static_cast<int64_t>(scaled) : 0;
+        }
+
+        // Пишет числа компактного вывода через один разделитель. Перед отрицательным числом
+        // пробел не нужен: минус сам отделяет его от предыдущего
+        class CompactNumbers {
+        public:
+            CompactNumbers(Serializer& serializer, int precision)
+                    : serializer_(serializer)
+                    , precision_(precision) {
+            }
+
+            // Атрибут name="value"
+            void Attr(std::string_view name, double value) {
+                serializer_ << ' ' << name << "=\""sv;
+                serializer_.AppendFixed(Scale(value, precision_), precision_);
+                serializer_ << '"';
+            }
+
+            // Очередное число списка; после буквы команды пути разделитель не ставится
+            void ListItem(int64_t scaled) {
+                if (!after_command_ && scaled >= 0) {
+                    serializer_ << ' ';
+                }
+                after_command_ = false;
+                serializer_.AppendFixed(scaled, precision_);
+            }
+
+            void Command(char command) {
+                serializer_ << command;
+                after_command_ = true;
+            }
+
+        private:
+            Serializer& serializer_;
+            int precision_;
+            bool after_command_ = false;
+        };
+
+        //Открывающий тег svg. Границы видимой области выводятся точно: у тайлов крупного масштаба
+        //они малы по сравнению с координатами
+        void RenderSvgTag(Serializer& serializer, const std::optional<std::array<double, 4>>& view_box) {
+            serializer << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\""sv;
+            if (view_box) {
+                serializer << " viewBox=\""sv;
+                for (size_t i = 0; i < view_box->size(); ++i) {
+                    if (i != 0) {
+                        serializer << ' ';
+                    }
+                    serializer.AppendShortest((*view_box)[i]);
+                }
+                serializer << '"';
+            }
+            serializer << '>';
+        }
+
+        // Выводит команды [0, count) через render_range(serializer, begin, end). На нескольких потоках
+        // команды делятся на порции по границам, для которых can_split(boundary) истинно; каждая порция
+        // выводится в свой буфер, буферы пишутся по порядку, так что результат не зависит от числа потоков
+        template <typename CanSplit, typename RenderRange>
+        void RenderCommands(Serializer& serializer, size_t count, size_t threads, CanSplit can_split,
+                            RenderRange render_range) {
+            const size_t chunk_size = std::max(MIN_CHUNK_SIZE, count / (std::max<size_t>(threads, 1) * CHUNKS_PER_THREAD));
+            if (threads <= 1 || count <= chunk_size) {
+                render_range(serializer, size_t{0}, count);
+                return;
+            }
+            std::vector<size_t> bounds{0};
+            while (bounds.back() < count) {
+                size_t end = std::min(count, bounds.back() + chunk_size);
+                while (end < count && !can_split(end)) {
+                    ++end;
+                }
+                bounds.push_back(end);
+            }
+            std::vector<std::string> parts(bounds.size() - 1);
+            parallel::ParallelFor(parts.size(), threads, [&bounds, &parts, &render_range](size_t part) {
+                Serializer part_serializer;
+                render_range(part_serializer, bounds[part], bounds[part + 1]);
+                parts[part] = std::move(part_serializer.Buffer());
+            });
+            for (const std::string& part : parts) {
+                serializer.Write(part);
+            }
+        }
+
+        void CheckPrecision(int precision) {
+            if (precision < 0 || precision > MAX_PRECISION) {
+                throw std::invalid_argument("SVG precision must be in [0, " + std::to_string(MAX_PRECISION) + "]");
+            }
+        }
+
+        uint32_t CheckedIndex(size_t size) {
+            if (size > UINT32_MAX) {
+                throw std::length_error("Too many objects in SVG document");
+            }
+            return static_cast<uint32_t>(size);
+        }
+    }//namespace
+
+// ---------- Style ------------------
+
+    std::string Style::AttrsText() const {
+        std::ostringstream out;
+        RenderAttrs(out);
+        return out.str();
+    }
+
+    std::string Style::CssText() const {
+        std::ostringstream out;
+        RenderCss(out);
+        return out.str();
+    }
+
+    bool Style::HasOpaqueFill() const {
+        const auto& fill = GetFillColor();
+        if (!fill) {
+            return false;
+        }
+        if (const auto* name = std::get_if<std::string>(&*fill)) {
+            return *name != NoneColor && *name != "transparent"sv;
+        }
+        if (const auto* rgba = std::get_if<Rgba>(&*fill)) {
+            return rgba->opacity >= 1.0;
+        }
+        return std::holds_alternative<Rgb>(*fill);
+    }
+
+    bool Style::HasOnlyFill() const {
+        return GetFillColor() && Style().SetFillColor(*GetFillColor()).AttrsText() == AttrsText();
+    }
+
+    bool Style::HasStroke() const {
+        const auto& stroke = GetStrokeColor();
+        return stroke && !std::holds_alternative<std::monostate>(*stroke);
+    }
+
+// ---------- FlatDocument ------------------
+
+    StyleId FlatDocument::AddStyle(const Style& style) {
+        styles_.push_back({style, style.AttrsText(), style.CssText()});
+        return CheckedIndex(styles_.size() - 1);
+    }
+
+    FontId FlatDocument::AddFont(Font font) {
+        fonts_.push_back(std::move(font));
+        return CheckedIndex(fonts_.size() - 1);
+    }
+
+    void FlatDocument::AddCircle(Point center, double radius, StyleId style) {
+        commands_.push_back({Kind::CIRCLE, CheckedIndex(circles_.size())});
+        circles_.push_back({center, radius, style});
+    }
+
+    void FlatDocument::StartPolyline(StyleId style) {
+        commands_.push_back({Kind::POLYLINE, CheckedIndex(polylines_.size())});
+        polylines_.push_back({style, CheckedIndex(points_.size()), 0});
+    }
+
+    void FlatDocument::AddPoint(Point point) {
+        if (commands_.empty() || commands_.back().kind != Kind::POLYLINE) {
+            throw std::logic_error("AddPoint without StartPolyline");
+        }
+        points_.push_back(point);
+        ++polylines_.back().point_count;
+    }
+
+    void FlatDocument::AddText(Point position, Point offset, FontId font, StyleId style, std::string_view data) {
+        commands_.push_back({Kind::TEXT, CheckedIndex(texts_.size())});
+        texts_.push_back({position, offset, font, style, CheckedIndex(text_data_.size()), CheckedIndex(data.size())});
+        text_data_ += data;
+    }
+
+    void FlatDocument::SetViewBox(Point origin, double width, double height) {
+        view_box_ = {origin.x, origin.y, width, height};
+    }
+
+    void FlatDocument::Append(const FlatDocument& other) {
+        //Одинаковое оформление и шрифты не дублируются
+        std::vector<StyleId> style_ids;
+        style_ids.reserve(other.styles_.size());
+        std::unordered_map<std::string, StyleId> known_styles;
+        for (StyleId id = 0; id < styles_.size(); ++id) {
+            known_styles.emplace(styles_[id].attrs, id);
+        }
+        for (const StyleText& style : other.styles_) {
+            const auto it = known_styles.find(style.attrs);
+            style_ids.push_back(it != known_styles.end() ? it->second : AddStyle(style.style));
+        }
+        std::vector<FontId> font_ids;
+        font_ids.reserve(other.fonts_.size());
+        for (const Font& font : other.fonts_) {
+            const auto it = std::find_if(fonts_.begin(), fonts_.end(), [&font](const Font& known) {
+                return known.size == font.size && known.family == font.family && known.weight == font.weight;
+            });
+            font_ids.push_back(it != fonts_.end() ? static_cast<FontId>(it - fonts_.begin()) : AddFont(font));
+        }
+
+        const uint32_t circle_base = CheckedIndex(circles_.size());
+        const uint32_t polyline_base = CheckedIndex(polylines_.size());
+        const uint32_t text_base = CheckedIndex(texts_.size());
+        const uint32_t point_base = CheckedIndex(points_.size());
+        const uint32_t data_base = CheckedIndex(text_data_.size());
+        CheckedIndex(commands_.size() + other.commands_.size());
+        CheckedIndex(points_.size() + other.points_.size());
+        CheckedIndex(text_data_.size() + other.text_data_.size());
+
+        for (const Command command : other.commands_) {
+            switch (command.kind) {
+                case Kind::CIRCLE:
+                    commands_.push_back({command.kind, circle_base + command.index});
+                    break;
+                case Kind::POLYLINE:
+                    commands_.push_back({command.kind, polyline_base + command.index});
+                    break;
+                case Kind::TEXT:
+                    commands_.push_back({command.kind, text_base + command.index});
+                    break;
+            }
+        }
+        for (CircleItem circle : other.circles_) {
+            circle.style = style_ids[circle.style];
+            circles_.push_back(circle);
+        }
+        for (PolylineItem polyline : other.polylines_) {
+            polyline.style = style_ids[polyline.style];
+            polyline.first_point += point_base;
+            polylines_.push_back(polyline);
+        }
+        points_.insert(points_.end(), other.points_.begin(), other.points_.end());
+        for (TextItem text : other.texts_) {
+            text.style = style_ids[text.style];
+            text.font = font_ids[text.font];
+            text.data_offset += data_base;
+            texts_.push_back(text);
+        }
+        text_data_ += other.text_data_;
+    }
+
+    size_t FlatDocument::ObjectCount() const {
+        return commands_.size();
+    }
+
+    void FlatDocument::Render(std::ostream& out, const RenderOptions& options, size_t threads) const {
+        CheckPrecision(options.precision);
+        if (options.compact) {
+            RenderCompact(out, options.precision, threads);
+        } else {
+            RenderPlain(out, threads);
+        }
+    }
+
+    void FlatDocument::RenderOverlay(std::ostream& out, const RenderOptions& options) const {
+        CheckPrecision(options.precision);
+        if (options.compact) {
+            RenderCompact(out, options.precision, 1, false);
+        } else {
+            RenderPlain(out, 1, false);
+        }
+    }
+
+    void FlatDocument::RenderPlain(std::ostream& out, size_t threads, bool framed) const {
+        Serializer serializer(&out);
+        if (framed) {
+            serializer << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+            RenderSvgTag(serializer, view_box_);
+            serializer << '\n';
+        }
+        auto render_range = [this](Serializer& serializer, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const Command command = commands_[i];
+                serializer << "  "sv;
+                switch (command.kind) {
+                    case Kind::CIRCLE: {
+                        const CircleItem& circle = circles_[command.index];
+                        serializer << "<circle cx=\""sv << circle.center.x << "\" cy=\""sv << circle.center.y
+                                   << "\" r=\""sv << circle.radius << '"' << styles_[circle.style].attrs << "/>"sv;
+                        break;
+                    }
+                    case Kind::POLYLINE: {
+                        const PolylineItem& polyline = polylines_[command.index];
+                        serializer << "<polyline points=\""sv;
+                        for (uint32_t vertex = 0; vertex < polyline.point_count; ++vertex) {
+                            const Point point = points_[polyline.first_point + vertex];
+                            if (vertex != 0) {
+                                serializer << ' ';
+                            }
+                            serializer << point.x << ',' << point.y;
+                        }
+                        serializer << '"' << styles_[polyline.style].attrs << "/>"sv;
+                        break;
+                    }
+                    case Kind::TEXT: {
+                        const TextItem& text = texts_[command.index];
+                        const Font& font = fonts_[text.font];
+                        serializer << "<text"sv << styles_[text.style].attrs
+                                   << " x=\""sv << text.position.x << "\" y=\""sv << text.position.y
+                                   << "\" dx=\""sv << text.offset.x << "\" dy=\""sv << text.offset.y
+                                   << "\" font-size=\""sv << font.size;
+                        if (!font.family.empty()) {
+                            serializer << "\" font-family=\""sv << font.family;
+                        }
+                        if (!font.weight.empty()) {
+                            serializer << "\" font-weight=\""sv << font.weight;
+                        }
+                        serializer << "\">"sv;
+                        serializer.AppendXml(std::string_view(text_data_).substr(text.data_offset, text.data_size));
+                        serializer << "</text>"sv;
+                        break;
+                    }
+                }
+                serializer << '\n';
+                serializer.FlushIfFull();
+            }
+        };
+        RenderCommands(serializer, commands_.size(), threads, [](size_t) {
+            return true;
+        }, render_range);
+        if (framed) {
+            serializer << "</svg>"sv;
+        }
+    }
+
+    bool FlatDocument::IsHaloPair(size_t command) const {
+        if (command + 1 >= commands_.size() || commands_[command].kind != Kind::TEXT
+            || commands_[command + 1].kind != Kind::TEXT) {
+            return false;
+        }
+        const TextItem& underlayer = texts_[commands_[command].index];
+        const TextItem& text = texts_[commands_[command + 1].index];
+        const Style& underlayer_style = styles_[underlayer.style].style;
+        const Style& text_style = styles_[text.style].style;
+        //Непрозрачная заливка текста целиком закрывает заливку подложки, поэтому от подложки нужна только обводка
+        return underlayer.position == text.position && underlayer.offset == text.offset
+               && underlayer.font == text.font
+               && std::string_view(text_data_).substr(underlayer.data_offset, underlayer.data_size)
+                  == std::string_view(text_data_).substr(text.data_offset, text.data_size)
+               && underlayer_style.HasStroke() && text_style.HasOnlyFill() && text_style.HasOpaqueFill();
+    }
+
+    void FlatDocument::RenderCompact(std::ostream& out, int precision, size_t threads, bool framed) const {
+        //Классы получают только используемые стили и шрифты; одинаковые наборы свойств делят один класс
+        constexpr uint32_t NO_CLASS = UINT32_MAX;
+        std::vector<uint32_t> style_classes(styles_.size(), NO_CLASS);
+        std::vector<uint32_t> font_classes(fonts_.size(), NO_CLASS);
+        std::vector<std::string> style_rules;
+        std::vector<std::string> font_rules;
+        auto assign_class = [](std::vector<std::string>& rules, std::string rule) {
+            const auto it = std::find(rules.begin(), rules.end(), rule);
+            if (it != rules.end()) {
+                return static_cast<uint32_t>(it - rules.begin());
+            }
+            rules.push_back(std::move(rule));
+            return static_cast<uint32_t>(rules.size() - 1);
+        };
+        auto use_style = [&](StyleId style) {
+            if (style_classes[style] == NO_CLASS && !styles_[style].css.empty()) {
+                style_classes[style] = assign_class(style_rules, styles_[style].css);
+            }
+        };
+        auto use_font = [&](FontId font_id) {
+            if (font_classes[font_id] == NO_CLASS) {
+                const Font& font = fonts_[font_id];
+                std::string rule = "font-size:"s + std::to_string(font.size) + "px"s;
+                if (!font.family.empty()) {
+                    rule += ";font-family:"s + font.family;
+                }
+                if (!font.weight.empty()) {
+                    rule += ";font-weight:"s + font.weight;
+                }
+                font_classes[font_id] = assign_class(font_rules, std::move(rule));
+            }
+        };
+        //Пара «подложка + текст» получает свой класс: обводка подложки, заливка текста, обводка рисуется первой
+        std::map<std::pair<StyleId, StyleId>, uint32_t> halo_classes;
+        std::vector<uint32_t> halo_class_of(commands_.size(), NO_CLASS);
+        for (size_t i = 0; framed && i < commands_.size(); ++i) {
+            const Command command = commands_[i];
+            switch (command.kind) {
+                case Kind::CIRCLE:
+                    use_style(circles_[command.index].style);
+                    break;
+                case Kind::POLYLINE:
+                    use_style(polylines_[command.index].style);
+                    break;
+                case Kind::TEXT: {
+                    const TextItem& text = texts_[command.index];
+                    use_font(text.font);
+                    if (!IsHaloPair(i)) {
+                        use_style(text.style);
+                        break;
+                    }
+                    const StyleId fill = texts_[commands_[i + 1].index].style;
+                    if (!halo_classes.count({text.style, fill})) {
+                        Style halo = styles_[text.style].style;
+                        halo.SetFillColor(*styles_[fill].style.GetFillColor());
+                        halo_classes[{text.style, fill}] = assign_class(style_rules, halo.CssText() + ";paint-order:stroke"s);
+                    }
+                    halo_class_of[i++] = halo_classes.at({text.style, fill});
+                    break;
+                }
+            }
+        }
+
+        Serializer serializer(&out);
+        if (framed) {
+            serializer << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv;
+            RenderSvgTag(serializer, view_box_);
+        }
+        if (!style_rules.empty() || !font_rules.empty()) {
+            serializer << "<style>"sv;
+            for (uint32_t i = 0; i < style_rules.size(); ++i) {
+                serializer << ".s"sv << i << '{' << style_rules[i] << '}';
+            }
+            for (uint32_t i = 0; i < font_rules.size(); ++i) {
+                serializer << ".f"sv << i << '{' << font_rules[i] << '}';
+            }
+            serializer << "</style>"sv;
+        }
+
+        auto render_range = [&](Serializer& serializer, size_t begin, size_t end) {
+            CompactNumbers numbers(serializer, precision);
+            //Без классов (слой поверх документа) оформление и шрифт выводятся атрибутами
+            auto render_attrs = [&](StyleId style, std::optional<FontId> font) {
+                serializer << styles_[style].attrs;
+                if (!font) {
+                    return;
+                }
+                serializer << " font-size=\""sv << fonts_[*font].size << '"';
+                if (!fonts_[*font].family.empty()) {
+                    serializer << " font-family=\""sv << fonts_[*font].family << '"';
+                }
+                if (!fonts_[*font].weight.empty()) {
+                    serializer << " font-weight=\""sv << fonts_[*font].weight << '"';
+                }
+            };
+            auto render_class = [&serializer](uint32_t style_class, uint32_t font_class) {
+                if (style_class == NO_CLASS && font_class == NO_CLASS) {
+                    return;
+                }
+                serializer << " class=\""sv;
+                if (style_class != NO_CLASS) {
+                    serializer << 's' << style_class;
+                }
+                if (font_class != NO_CLASS) {
+                    if (style_class != NO_CLASS) {
+                        serializer << ' ';
+                    }
+                    serializer << 'f' << font_class;
+                }
+                serializer << '"';
+            };
+
+            for (size_t i = begin; i < end; ++i) {
+                const Command command = commands_[i];
+                switch (command.kind) {
+                    case Kind::CIRCLE: {
+                        const CircleItem& circle = circles_[command.index];
+                        serializer << "<circle"sv;
+                        framed ? render_class(style_classes[circle.style], NO_CLASS) : render_attrs(circle.style, std::nullopt);
+                        numbers.Attr("cx"sv, circle.center.x);
+                        numbers.Attr("cy"sv, circle.center.y);
+                        numbers.Attr("r"sv, circle.radius);
+                        serializer << "/>"sv;
+                        break;
+                    }
+                    case Kind::POLYLINE: {
+                        //Первая вершина задаётся абсолютно, остальные — смещением от предыдущей.
+                        //Смещения считаются по уже округлённым координатам, поэтому ошибка не накапливается
+                        const PolylineItem& polyline = polylines_[command.index];
+                        serializer << "<path"sv;
+                        framed ? render_class(style_classes[polyline.style], NO_CLASS) : render_attrs(polyline.style, std::nullopt);
+                        serializer << " d=\""sv;
+                        int64_t x = 0;
+                        int64_t y = 0;
+                        for (uint32_t vertex = 0; vertex < polyline.point_count; ++vertex) {
+                            const Point point = points_[polyline.first_point + vertex];
+                            const int64_t next_x = Scale(point.x, precision);
+                            const int64_t next_y = Scale(point.y, precision);
+                            if (vertex == 0) {
+                                numbers.Command('M');
+                                numbers.ListItem(next_x);
+                                numbers.ListItem(next_y);
+                            } else {
+                                if (vertex == 1) {
+                                    numbers.Command('l');
+                                }
+                                numbers.ListItem(next_x - x);
+                                numbers.ListItem(next_y - y);
+                            }
+                            x = next_x;
+                            y = next_y;
+                        }
+                        serializer << "\"/>"sv;
+                        break;
+                    }
+                    case Kind::TEXT: {
+                        const TextItem& text = texts_[command.index];
+                        serializer << "<text"sv;
+                        if (!framed) {
+                            render_attrs(text.style, text.font);
+                        } else if (halo_class_of[i] != NO_CLASS) {
+                            render_class(halo_class_of[i++], font_classes[text.font]);
+                        } else {
+                            render_class(style_classes[text.style], font_classes[text.font]);
+                        }
+                        //У текста из одного фрагмента смещение dx, dy равносильно сдвигу опорной точки
+                        numbers.Attr("x"sv, text.position.x + text.offset.x);
+                        numbers.Attr("y"sv, text.position.y + text.offset.y);
+                        serializer << '>';
+                        serializer.AppendXml(std::string_view(text_data_).substr(text.data_offset, text.data_size));
+                        serializer << "</text>"sv;
+                        break;
+                    }
+                }
+                serializer.FlushIfFull();
+            }
+        };
+        //Пара «подложка + текст» выводится одним элементом, поэтому не разрывается между порциями
+        RenderCommands(serializer, commands_.size(), threads, [&halo_class_of](size_t boundary) {
+            return halo_class_of[boundary - 1] == NO_CLASS;
+        }, render_range);
+        if (framed) {
+            serializer << "</svg>"sv;
+        }
+    }
+
+}  // namespace svg
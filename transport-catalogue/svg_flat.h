@@ -0,0 +1,142 @@
+#pragma once
+
+#include "svg.h"
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Плоский SVG-документ для больших карт. Примитивы не создаются отдельными объектами в куче:
+// они записываются в непрерывные типизированные массивы, оформление и шрифты хранятся один раз
+// в таблицах документа, а при выводе всё сериализуется в байтовый буфер.
+// Обычный вывод побайтно совпадает с svg::Document из тех же Circle, Polyline и Text,
+// компактный (RenderOptions::compact) рисует ту же картинку в несколько раз меньшим текстом
+namespace svg {
+
+    // Набор атрибутов оформления, общий для многих примитивов
+    class Style final : public PathProps<Style> {
+    public:
+        // Атрибуты в том виде, в каком их выводят Circle, Polyline и Text
+        std::string AttrsText() const;
+        // Те же свойства как тело правила CSS
+        std::string CssText() const;
+
+        // Заливка задана и заведомо непрозрачна
+        bool HasOpaqueFill() const;
+        // Задана только заливка
+        bool HasOnlyFill() const;
+        bool HasStroke() const;
+    };
+
+    struct Font {
+        uint32_t size = 1;
+        std::string family;
+        std::string weight;
+    };
+
+    struct RenderOptions {
+        // Оформление и шрифты выводятся один раз классами CSS, ломаные — элементами path
+        // с относительными координатами, числа округляются до precision знаков после точки, отступов нет
+        bool compact = false;
+        int precision = 2;
+    };
+
+    inline bool operator==(const RenderOptions& lhs, const RenderOptions& rhs) {
+        return lhs.compact == rhs.compact && lhs.precision == rhs.precision;
+    }
+
+    // Наибольшая поддерживаемая RenderOptions::precision
+    inline constexpr int MAX_PRECISION = 9;
+
+    using StyleId = uint32_t;
+    using FontId = uint32_t;
+
+    class FlatDocument {
+    public:
+        StyleId AddStyle(const Style& style);
+        FontId AddFont(Font font);
+
+        void AddCircle(Point center, double radius, StyleId style);
+        // Начинает ломаную: вершины добавляются AddPoint до следующего примитива
+        void StartPolyline(StyleId style);
+        void AddPoint(Point point);
+        void AddText(Point position, Point offset, FontId font, StyleId style, std::string_view data);
+
+        // Видимая область (атрибут viewBox элемента svg), например для тайла карты
+        void SetViewBox(Point origin, double width, double height);
+
+        // Дописывает примитивы other после своих, с его оформлением и шрифтами
+        void Append(const FlatDocument& other);
+
+        size_t ObjectCount() const;
+
+        // На нескольких потоках примитивы выводятся порциями в отдельные буферы; результат тот же, что на одном
+        void Render(std::ostream& out, const RenderOptions& options = {}, size_t threads = 1) const;
+        // Только примитивы, без заголовка и закрывающего тега и с оформлением в атрибутах:
+        // слой, который вставляется в уже выведенный документ перед его </svg>.
+        // В компактном режиме числа и ломаные выводятся так же, как в компактном документе, но без классов
+        void RenderOverlay(std::ostream& out, const RenderOptions& options = {}) const;
+
+    private:
+        enum class Kind : uint8_t {
+            CIRCLE,
+            POLYLINE,
+            TEXT,
+        };
+
+        // Порядок вывода: вид примитива и его номер в массиве своего вида
+        struct Command {
+            Kind kind;
+            uint32_t index;
+        };
+
+        struct CircleItem {
+            Point center;
+            double radius;
+            StyleId style;
+        };
+
+        struct PolylineItem {
+            StyleId style;
+            uint32_t first_point;
+            uint32_t point_count;
+        };
+
+        struct TextItem {
+            Point position;
+            Point offset;
+            FontId font;
+            StyleId style;
+            uint32_t data_offset;
+            uint32_t data_size;
+        };
+
+        struct StyleText {
+            Style style;
+            std::string attrs;
+            std::string css;
+        };
+
+        std::vector<StyleText> styles_;
+        std::vector<Font> fonts_;
+        std::vector<Command> commands_;
+        std::vector<CircleItem> circles_;
+        std::vector<PolylineItem> polylines_;
+        std::vector<Point> points_;
+        std::vector<TextItem> texts_;
+        std::string text_data_;
+        std::optional<std::array<double, 4>> view_box_;
+        // framed — с заголовком, закрывающим тегом и (в компактном виде) классами CSS;
+        // без него оформление выводится атрибутами каждого примитива
+        void RenderPlain(std::ostream& out, size_t threads, bool framed = true) const;
+        void RenderCompact(std::ostream& out, int precision, size_t threads, bool framed = true) const;
+        // Пара подписей «подложка + текст» с общими положением, шрифтом и содержимым,
+        // которую в компактном режиме можно вывести одним элементом с paint-order: stroke
+        bool IsHaloPair(size_t command) const;
+    };
+
+}  // namespace svg
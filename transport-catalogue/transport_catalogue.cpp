@@ -1,6 +1,7 @@
 #include "transport_catalogue.h"
 #include <functional>
 #include <cstdlib>
+#include <atomic>
 #include <limits>
 
 namespace transport_catalogue {
@@ -61,13 +62,14 @@ namespace transport_catalogue {
         //Находим имя остановки
         stop_sv.remove_prefix(4); //Убираем слово Stop
         stop.stop_name = FindName(stop_sv, ':');
+        stop.id = stops_.size();
         //Преобразуем строковые значения широты и долготы в числовые
         std::string_view lat_ = FindName(stop_sv, ',');
         stop.latitude = std::stod({lat_.data(), lat_.size()});
         std::string_view lng_ = FindName(stop_sv, ',');
         stop.longitude = std::stod({lng_.data(), lng_.size()});
         stop.next_stops = stop_sv; //string_view с оставшейся информацией для последующей обработки
-        stops_.insert({stop.stop_name, stop});
+        stops_by_id_.push_back(&stops_.insert({stop.stop_name, stop}).first->second);
         buses_for_stops_.insert({stop.stop_name, {}});
     }
 
@@ -105,6 +107,11 @@ namespace transport_catalogue {
                 buses_for_stops_[stop_ptr->stop_name].insert(bus.bus_name);
             }
         }
+        ComputeGeoRouteLength(bus);
+        buses_in_order_.push_back(&buses_.insert({bus.bus_name, bus}).first->second);
+    }
+
+    void TransportCatalogue::ComputeGeoRouteLength(Bus &bus) {
         if(bus.route.size() > 1) {
             for (size_t i = 1; i < bus.route.size(); ++i) {
                 if (bus.route[i - 1] == bus.route[i]) {
@@ -118,7 +125,65 @@ namespace transport_catalogue {
         if (!bus.is_circle) {
             bus.r_length *= 2;
         }
-        buses_.insert({bus.bus_name, bus});
+    }
+
+    std::string_view TransportCatalogue::Intern(std::string_view name) {
+        return queries_.emplace_back(name);
+    }
+
+    void TransportCatalogue::AddStop(std::string_view name, geo::Coordinates coordinates) {
+        if (stops_.count(name)) {
+            return;
+        }
+        Stop stop;
+        stop.stop_name = Intern(name);
+        stop.id = stops_.size();
+        stop.latitude = coordinates.lat;
+        stop.longitude = coordinates.lng;
+        stops_by_id_.push_back(&stops_.insert({stop.stop_name, stop}).first->second);
+        buses_for_stops_.insert({stop.stop_name, {}});
+        version_ = NextVersion();
+    }
+
+    void TransportCatalogue::SetDistance(std::string_view from, std::string_view to, uint32_t distance) {
+        auto from_it = stops_.find(from);
+        auto to_it = stops_.find(to);
+        if (from_it == stops_.end() || to_it == stops_.end()) {
+            return;
+        }
+        from_it->second.dist_to_next[to_it->second.stop_name] = distance;
+        version_ = NextVersion();
+    }
+
+    void TransportCatalogue::AddBus(std::string_view name, const std::vector<std::string_view> &stops, bool is_circle) {
+        if (buses_.count(name)) {
+            return;
+        }
+        Bus bus;
+        bus.bus_name = Intern(name);
+        bus.is_circle = is_circle;
+        bus.route.reserve(stops.size());
+        for (const auto stop_name : stops) {
+            auto it = stops_.find(stop_name);
+            if (it != stops_.end()) {
+                bus.route.push_back(&it->second);
+                buses_for_stops_[it->second.stop_name].insert(bus.bus_name);
+            }
+        }
+        ComputeGeoRouteLength(bus);
+        ComputeRealRouteLength(bus);
+        buses_in_order_.push_back(&buses_.insert({bus.bus_name, bus}).first->second);
+        version_ = NextVersion();
+    }
+
+    uint64_t TransportCatalogue::Version() const {
+        return version_;
+    }
+
+    uint64_t TransportCatalogue::NextVersion() {
+        //Общий счётчик на все справочники, чтобы версии разных справочников не совпадали
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
     }
 
     void TransportCatalogue::ComputeRealRouteLength(Bus &bus) {
@@ -158,39 +223,86 @@ namespace transport_catalogue {
 
     BusRoute TransportCatalogue::RouteInformation(std::string_view bus) const {
         RemoveBeginEndSpaces(bus);
-        BusRoute route;
-        if (buses_.count(bus)) {
-            route.is_found = true;
-            std::set<const Stop *> unique_stops(buses_.at(bus).route.begin(), buses_.at(bus).route.end());
-            route.bus_name = {buses_.at(bus).bus_name.data(), buses_.at(bus).bus_name.size()};
-            route.stops = (buses_.at(bus).is_circle) ? (buses_.at(bus).route.size()) : (
-                    buses_.at(bus).route.size() * 2 - 1);
-            route.unique_stops = unique_stops.size();
-            route.true_length = buses_.at(bus).true_length;
-            route.curvature = buses_.at(bus).curvature;
-        } else {
-            route.bus_name = {bus.data(), bus.size()};
+        if (const Bus* found = GetBus(bus)) {
+            return RouteInformation(*found);
         }
+        BusRoute route;
+        route.bus_name = bus;
+        return route;
+    }
+
+    BusRoute TransportCatalogue::RouteInformation(const Bus &bus) const {
+        BusRoute route;
+        route.is_found = true;
+        std::set<const Stop *> unique_stops(bus.route.begin(), bus.route.end());
+        route.bus_name = bus.bus_name;
+        route.stops = (bus.is_circle) ? (bus.route.size()) : (bus.route.size() * 2 - 1);
+        route.unique_stops = unique_stops.size();
+        route.true_length = bus.true_length;
+        route.curvature = bus.curvature;
         return route;
     }
 
     StopRoutes TransportCatalogue::StopInformation(std::string_view stop) const{
         RemoveBeginEndSpaces(stop);
-        StopRoutes buses_for_stop;
-        if (buses_for_stops_.count(stop)) {
-            buses_for_stop.is_found = true;
-            buses_for_stop.stop_name = {stops_.at(stop).stop_name.data(), stops_.at(stop).stop_name.size()};
-            buses_for_stop.routes = buses_for_stops_.at(stop);
-        } else {
-            buses_for_stop.stop_name = {stop.data(), stop.size()};
+        if (const Stop* found = GetStop(stop)) {
+            return StopInformation(*found);
         }
+        StopRoutes buses_for_stop;
+        buses_for_stop.stop_name = stop;
+        return buses_for_stop;
+    }
+
+    StopRoutes TransportCatalogue::StopInformation(const Stop &stop) const {
+        StopRoutes buses_for_stop;
+        buses_for_stop.is_found = true;
+        buses_for_stop.stop_name = stop.stop_name;
+        buses_for_stop.routes = &buses_for_stops_.at(stop.stop_name);
         return buses_for_stop;
     }
 
+    const Bus *TransportCatalogue::GetBus(std::string_view bus) const {
+        auto it = buses_.find(bus);
+        return it != buses_.end() ? &it->second : nullptr;
+    }
+
+    const Stop *TransportCatalogue::GetStop(std::string_view stop) const {
+        auto it = stops_.find(stop);
+        return it != stops_.end() ? &it->second : nullptr;
+    }
+
+    void TransportCatalogue::Resolve(StatRequest &request) const {
+        if (auto* query = std::get_if<BusQuery>(&request.query)) {
+            query->bus = GetBus(query->name);
+        }
+        else if (auto* query = std::get_if<StopQuery>(&request.query)) {
+            query->stop = GetStop(query->name);
+        }
+        else if (auto* query = std::get_if<RouteQuery>(&request.query)) {
+            query->from_stop = GetStop(query->from);
+            query->to_stop = GetStop(query->to);
+        }
+        else if (auto* query = std::get_if<RouteMapQuery>(&request.query)) {
+            query->route.from_stop = GetStop(query->route.from);
+            query->route.to_stop = GetStop(query->route.to);
+        }
+        request.is_resolved = true;
+    }
+
     const std::unordered_map<std::string_view, Bus> & TransportCatalogue::GetBuses() const {
         return buses_;
     }
 
+    std::map<std::string_view, const Bus*> TransportCatalogue::GetActiveBuses() const {
+        std::map<std::string_view, const Bus*> active_buses;
+        for(const auto&[name, bus] : buses_){
+            if(!bus.route.empty()){
+                active_buses.insert({name, &bus});
+            }
+        }
+        return active_buses;
+    }
+
     std::optional<uint32_t> TransportCatalogue::GetDistanceBetweenStops(const Stop &lhs, const Stop &rhs) const {
         if(lhs.dist_to_next.count(rhs.stop_name)){
             return lhs.dist_to_next.at(rhs.stop_name);
@@ -204,4 +316,42 @@ namespace transport_catalogue {
     const std::unordered_map<std::string_view, Stop> &TransportCatalogue::GetStops() const {
         return stops_;
     }
+
+    const std::vector<const Stop*>& TransportCatalogue::GetStopsById() const {
+        return stops_by_id_;
+    }
+
+    const std::vector<const Bus*>& TransportCatalogue::GetBusesInOrder() const {
+        return buses_in_order_;
+    }
+
+    memory::Report TransportCatalogue::MemoryUsage() const {
+        memory::Report report;
+        report["object"] = {sizeof(*this), 0};
+
+        auto& names = report["names"];
+        names += memory::Heap(queries_);
+        for (const auto& str : queries_) {
+            names += memory::Heap(str);
+        }
+
+        auto& stops = report["stops"];
+        stops += memory::Heap(stops_) + memory::Heap(stops_by_id_);
+        for (const auto& [name, stop] : stops_) {
+            stops += memory::Heap(stop.dist_to_next);
+        }
+
+        auto& buses = report["buses"];
+        buses += memory::Heap(buses_) + memory::Heap(buses_in_order_);
+        for (const auto& [name, bus] : buses_) {
+            buses += memory::Heap(bus.route);
+        }
+
+        auto& buses_for_stops = report["buses_for_stops"];
+        buses_for_stops += memory::Heap(buses_for_stops_);
+        for (const auto& [name, routes] : buses_for_stops_) {
+            buses_for_stops += memory::Heap(routes);
+        }
+        return report;
+    }
 }
\ No newline at end of file
@@ -6,9 +6,11 @@
 #include <deque>
 #include <vector>
 #include <functional>
+#include <map>
 #include <set>
 #include <cstdint>
 #include "domain.h"
+#include "memory_usage.h"
 #include <optional>
 
 namespace transport_catalogue {
@@ -24,20 +26,54 @@ namespace transport_catalogue {
         Stop FindStop(std::string_view stop);
         Bus FindBus(std::string_view bus);
         BusRoute RouteInformation(std::string_view bus) const;
+        BusRoute RouteInformation(const Bus& bus) const;
         StopRoutes StopInformation(std::string_view stop) const;
+        StopRoutes StopInformation(const Stop& stop) const;
+        // Поиск без копирования, nullptr если не найдено
+        const Bus* GetBus(std::string_view bus) const;
+        const Stop* GetStop(std::string_view stop) const;
+        // Разрешает названия в запросе в указатели на объекты справочника
+        void Resolve(StatRequest& request) const;
         const std::unordered_map<std::string_view, Bus> & GetBuses() const;
+        // Непустые маршруты в порядке названий — то, что рисуется на карте
+        std::map<std::string_view, const Bus*> GetActiveBuses() const;
         std::optional<uint32_t> GetDistanceBetweenStops(const Stop& lhs, const Stop& rhs) const;
         const std::unordered_map<std::string_view, Stop>& GetStops() const;
+        // Остановки в порядке добавления: индекс в векторе совпадает с Stop::id
+        const std::vector<const Stop*>& GetStopsById() const;
+        // Маршруты в порядке добавления
+        const std::vector<const Bus*>& GetBusesInOrder() const;
+
+        // Добавляет остановку, название копируется во внутреннее хранилище
+        void AddStop(std::string_view name, geo::Coordinates coordinates);
+        // Задаёт дорожное расстояние между уже добавленными остановками
+        void SetDistance(std::string_view from, std::string_view to, uint32_t distance);
+        // Добавляет маршрут по названиям остановок. Остановки и расстояния должны быть добавлены заранее
+        void AddBus(std::string_view name, const std::vector<std::string_view>& stops, bool is_circle);
+
+        // Версия содержимого: меняется при каждом добавлении остановки, расстояния или маршрута.
+        // Версии разных справочников не совпадают, поэтому по ней можно сбрасывать кэши
+        uint64_t Version() const;
+
+        // Оценка занимаемой памяти по составным частям
+        memory::Report MemoryUsage() const;
 
     private:
         std::deque<std::string> queries_;
         std::unordered_map<std::string_view, Stop> stops_;
         std::unordered_map<std::string_view, Bus> buses_;
+        std::vector<const Stop*> stops_by_id_;
+        std::vector<const Bus*> buses_in_order_;
         std::unordered_map<std::string_view, std::set<std::string_view>> buses_for_stops_;
+        uint64_t version_ = NextVersion();
+
+        static uint64_t NextVersion();
 
         void AddStop(std::string_view stop_sv);
         void AddNextStops(Stop &stop);
         void AddBus(std::string_view bus_sv);
         void ComputeRealRouteLength(Bus &bus);
+        void ComputeGeoRouteLength(Bus &bus);
+        std::string_view Intern(std::string_view name);
     };
 }//namespace transport_catalogue
\ No newline at end of file
@@ -1,25 +1,26 @@
 #include "transport_router.h"
+#include "profile.h"
 
 TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue &tc, RouterSettings router_settings) : tc_(tc)
         , router_settings_(router_settings)
-        , graph_(tc_.GetStops().size()){
-    uint32_t i = 0;
-    for(const auto& [name, stop] : tc.GetStops()){
-        stop_ids_.insert({name, i});
-        ++i;
-    }
+        , graph_(tc_.GetStopsById().size()){
     SetEdges();
     route_ = std::make_shared<graph::Router<double>>(graph_);
 }
 
 void TransportRouter::SetEdges() {
+    static profile::Site site("router.set_edges");
+    static profile::Counter edges("router.edges");
+    static profile::Counter vertices("router.vertices");
+    const profile::ScopedTimer timer(site);
     uint32_t edge_num = 0;
-    for(const auto& [name, bus] : tc_.GetBuses()){
+    for(const Bus* bus_ptr : tc_.GetBusesInOrder()){
+        const Bus& bus = *bus_ptr;
         for(auto first_stop = bus.route.begin(); first_stop != bus.route.end(); ++first_stop){
-            graph::VertexId first = stop_ids_.at((*first_stop)->stop_name);
+            graph::VertexId first = (*first_stop)->id;
             double weight = router_settings_.bus_wait_time_;
             for(auto last_stop = std::next(first_stop); last_stop != bus.route.end(); ++last_stop){
-                graph::VertexId last = stop_ids_.at((*last_stop)->stop_name);
+                graph::VertexId last = (*last_stop)->id;
                 std::optional<uint32_t> dist = tc_.GetDistanceBetweenStops(*(*(std::prev(last_stop))), *(*last_stop));
                 if(dist.has_value()){
                     weight += dist.value() / (router_settings_.bus_velocity_ * 1000 / 60);
@@ -33,10 +34,10 @@ void TransportRouter::SetEdges() {
         }
         if(!bus.is_circle) {
             for (auto first_stop = bus.route.rbegin(); first_stop != bus.route.rend(); ++first_stop) {
-                graph::VertexId first = stop_ids_.at((*first_stop)->stop_name);
+                graph::VertexId first = (*first_stop)->id;
                 double weight = router_settings_.bus_wait_time_;
                 for (auto last_stop = std::next(first_stop); last_stop != bus.route.rend(); ++last_stop) {
-                    graph::VertexId last = stop_ids_.at((*last_stop)->stop_name);
+                    graph::VertexId last = (*last_stop)->id;
                     std::optional<uint32_t> dist = tc_.GetDistanceBetweenStops(*(*(std::prev(last_stop))),
                                                                                *(*last_stop));
                     if (dist.has_value()) {
@@ -51,22 +52,49 @@ void TransportRouter::SetEdges() {
             }
         }
     }
+    edges.Add(edge_num);
+    vertices.Add(graph_.GetVertexCount());
 }
 
 BusTripRoute
-TransportRouter::GetRoute(std::string_view first_stop, std::string_view last_stop) {
-    BusTripRoute route;
-    if(!stop_ids_.count(first_stop) || !stop_ids_.count(last_stop)){
-        return route;
+TransportRouter::GetRoute(std::string_view first_stop, std::string_view last_stop) const {
+    const Stop* first = tc_.GetStop(first_stop);
+    const Stop* last = tc_.GetStop(last_stop);
+    if(!first || !last){
+        return {};
     }
-    auto result = route_->BuildRoute(stop_ids_.at(first_stop), stop_ids_.at(last_stop));
+    return GetRoute(*first, *last);
+}
+
+BusTripRoute TransportRouter::GetRoute(const Stop &first_stop, const Stop &last_stop) const {
+    BusTripRoute route;
+    static profile::Counter not_found("router.routes_not_found");
+    static profile::Counter edges_reconstructed("router.edges_reconstructed");
+    static profile::Histogram path_length("router.path_length", profile::Histogram::Unit::COUNT);
+    auto result = route_->BuildRoute(first_stop.id, last_stop.id);
     if(!result.has_value()){
+        not_found.Add();
         return route;
     }
+    edges_reconstructed.Add(result->edges.size());
+    path_length.Record(result->edges.size());
     route.is_found = true;
     route.total_time_ = result->weight;
+    route.stages_.reserve(result->edges.size());
     for(const auto& trip_edge : result.value().edges){
         route.stages_.push_back(edges_ids_.at(trip_edge));
     }
     return route;
-}
\ No newline at end of file
+}
+
+memory::Report TransportRouter::MemoryUsage() const {
+    memory::Report report;
+    report["object"] = {sizeof(*this), 0};
+    report["graph"] = graph_.MemoryUsage();
+    report["edges_ids"] = memory::Heap(edges_ids_);
+    if (route_) {
+        //make_shared размещает объект вместе с блоком управления (vptr и два счётчика)
+        report["router"] = memory::HeapBlock(sizeof(graph::Router<double>) + sizeof(void*) + 2 * sizeof(int)) + route_->MemoryUsage();
+    }
+    return report;
+}
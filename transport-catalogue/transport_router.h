@@ -23,16 +23,21 @@ struct BusTripRoute{
 };
 
 
+// Вершины графа нумеруются по Stop::id, рёбра добавляются по маршрутам в порядке их добавления
+// в справочник. Поэтому из маршрутов с равным временем выбирается один и тот же при любом способе
+// загрузки справочника (JSON, поток, снимок)
 class TransportRouter{
 public:
     TransportRouter(const transport_catalogue::TransportCatalogue& tc, RouterSettings router_settings);
-    BusTripRoute GetRoute(std::string_view first_stop, std::string_view last_stop);
+    BusTripRoute GetRoute(std::string_view first_stop, std::string_view last_stop) const;
+    BusTripRoute GetRoute(const Stop& first_stop, const Stop& last_stop) const;
+    // Оценка занимаемой памяти: граф, таблицы маршрутизатора и индексы
+    memory::Report MemoryUsage() const;
 
 private:
     const transport_catalogue::TransportCatalogue& tc_;
     RouterSettings router_settings_;
-    std::unordered_map<std::string_view, uint32_t> stop_ids_;
-    graph::DirectedWeightedGraph<double> graph_;
+    graph::DirectedWeightedGraph<double> graph_; // вершина графа — Stop::id
     std::shared_ptr<graph::Router<double>> route_;
     std::unordered_map<uint32_t, BusTripEdges> edges_ids_;
 
@@ -0,0 +1,166 @@
+#include "vector_tile.h"
+
+namespace vector_tile {
+
+    namespace {
+        //Типы полей protobuf
+        constexpr uint32_t VARINT = 0;
+        constexpr uint32_t LENGTH_DELIMITED = 2;
+
+        //Типы геометрии и команды MVT
+        constexpr uint32_t POINT = 1;
+        constexpr uint32_t LINESTRING = 2;
+        constexpr uint32_t MOVE_TO = 1;
+        constexpr uint32_t LINE_TO = 2;
+
+        constexpr uint32_t VERSION = 2;
+
+        void WriteVarint(std::string& out, uint64_t value) {
+            while (value >= 0x80) {
+                out += static_cast<char>((value & 0x7F) | 0x80);
+                value >>= 7;
+            }
+            out += static_cast<char>(value);
+        }
+
+        void WriteKey(std::string& out, uint32_t field, uint32_t wire_type) {
+            WriteVarint(out, (field << 3) | wire_type);
+        }
+
+        void WriteVarintField(std::string& out, uint32_t field, uint64_t value) {
+            WriteKey(out, field, VARINT);
+            WriteVarint(out, value);
+        }
+
+        void WriteBytesField(std::string& out, uint32_t field, std::string_view bytes) {
+            WriteKey(out, field, LENGTH_DELIMITED);
+            WriteVarint(out, bytes.size());
+            out += bytes;
+        }
+
+        void WritePackedField(std::string& out, uint32_t field, const std::vector<uint32_t>& values) {
+            std::string packed;
+            for (const uint32_t value : values) {
+                WriteVarint(packed, value);
+            }
+            WriteBytesField(out, field, packed);
+        }
+
+        uint32_t ZigZag(int32_t value) {
+            return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+        }
+
+        uint32_t Command(uint32_t id, uint32_t count) {
+            return (id & 0x7) | (count << 3);
+        }
+
+        std::string EncodeValue(const Value& value) {
+            std::string out;
+            if (const auto* text = std::get_if<std::string>(&value)) {
+                WriteBytesField(out, 1, *text);
+            } else if (const auto* number = std::get_if<uint64_t>(&value)) {
+                WriteVarintField(out, 5, *number);
+            } else {
+                WriteVarintField(out, 7, std::get<bool>(value) ? 1 : 0);
+            }
+            return out;
+        }
+    }//namespace
+
+    Layer::Layer(std::string name, uint32_t extent)
+            : name_(std::move(name))
+            , extent_(extent) {
+    }
+
+    void Layer::AddPoint(uint64_t id, Point point, const Tags& tags) {
+        AddFeature(id, POINT, {Command(MOVE_TO, 1), ZigZag(point.x), ZigZag(point.y)}, tags);
+    }
+
+    void Layer::AddLines(uint64_t id, const std::vector<std::vector<Point>>& lines, const Tags& tags) {
+        std::vector<uint32_t> geometry;
+        //Курсор общий для всех частей объекта: каждая точка — смещение от предыдущей
+        Point cursor;
+        std::vector<Point> unique;
+        for (const std::vector<Point>& line : lines) {
+            unique.clear();
+            for (const Point point : line) {
+                if (unique.empty() || point.x != unique.back().x || point.y != unique.back().y) {
+                    unique.push_back(point);
+                }
+            }
+            if (unique.size() < 2) {
+                continue;
+            }
+            geometry.push_back(Command(MOVE_TO, 1));
+            for (size_t i = 0; i < unique.size(); ++i) {
+                if (i == 1) {
+                    geometry.push_back(Command(LINE_TO, static_cast<uint32_t>(unique.size() - 1)));
+                }
+                geometry.push_back(ZigZag(unique[i].x - cursor.x));
+                geometry.push_back(ZigZag(unique[i].y - cursor.y));
+                cursor = unique[i];
+            }
+        }
+        if (!geometry.empty()) {
+            AddFeature(id, LINESTRING, geometry, tags);
+        }
+    }
+
+    void Layer::AddFeature(uint64_t id, uint32_t type, const std::vector<uint32_t>& geometry, const Tags& tags) {
+        //Теги — пары номеров в общих для слоя таблицах ключей и значений
+        std::vector<uint32_t> tag_indexes;
+        tag_indexes.reserve(2 * tags.size());
+        for (const auto& [key, value] : tags) {
+            auto key_it = key_indexes_.find(key);
+            if (key_it == key_indexes_.end()) {
+                key_it = key_indexes_.emplace(std::string(key), static_cast<uint32_t>(keys_.size())).first;
+                keys_.emplace_back(key);
+            }
+            auto value_it = value_indexes_.find(value);
+            if (value_it == value_indexes_.end()) {
+                value_it = value_indexes_.emplace(value, static_cast<uint32_t>(values_.size())).first;
+                values_.push_back(value);
+            }
+            tag_indexes.push_back(key_it->second);
+            tag_indexes.push_back(value_it->second);
+        }
+        std::string feature;
+        WriteVarintField(feature, 1, id);
+        if (!tag_indexes.empty()) {
+            WritePackedField(feature, 2, tag_indexes);
+        }
+        WriteVarintField(feature, 3, type);
+        WritePackedField(feature, 4, geometry);
+        WriteBytesField(features_, 2, feature);
+    }
+
+    bool Layer::IsEmpty() const {
+        return features_.empty();
+    }
+
+    std::string Layer::Encode() const {
+        std::string out;
+        WriteBytesField(out, 1, name_);
+        out += features_;
+        for (const std::string& key : keys_) {
+            WriteBytesField(out, 3, key);
+        }
+        for (const Value& value : values_) {
+            WriteBytesField(out, 4, EncodeValue(value));
+        }
+        WriteVarintField(out, 5, extent_);
+        WriteVarintField(out, 15, VERSION);
+        return out;
+    }
+
+    std::string EncodeTile(const std::vector<Layer>& layers) {
+        std::string out;
+        for (const Layer& layer : layers) {
+            if (!layer.IsEmpty()) {
+                WriteBytesField(out, 3, layer.Encode());
+            }
+        }
+        return out;
+    }
+
+}//namespace vector_tile
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Векторные тайлы в формате Mapbox Vector Tile 2.1 — сообщения protobuf, записанные без внешних библиотек.
+//
+// Tile    { repeated Layer layers = 3; }
+// Layer   { name = 1; repeated Feature features = 2; repeated keys = 3; repeated Value values = 4;
+//           extent = 5; version = 15; }
+// Feature { id = 1; packed tags = 2; type = 3; packed geometry = 4; }
+// Value   { string_value = 1; uint_value = 5; bool_value = 7; }
+//
+// Координаты — целые в системе тайла [0, extent), геометрия — команды MoveTo/LineTo,
+// смещения от предыдущей точки в кодировке zig-zag, все целые — varint
+namespace vector_tile {
+
+    inline constexpr uint32_t EXTENT = 4096;
+
+    struct Point {
+        int32_t x = 0;
+        int32_t y = 0;
+    };
+
+    using Value = std::variant<std::string, uint64_t, bool>;
+    using Tags = std::vector<std::pair<std::string_view, Value>>;
+
+    class Layer {
+    public:
+        explicit Layer(std::string name, uint32_t extent = EXTENT);
+
+        void AddPoint(uint64_t id, Point point, const Tags& tags);
+        // Ломаная из нескольких частей (MultiLineString). Повторы точек отбрасываются,
+        // части короче двух различных точек пропускаются, объект без частей не добавляется
+        void AddLines(uint64_t id, const std::vector<std::vector<Point>>& lines, const Tags& tags);
+
+        bool IsEmpty() const;
+        // Слой как сообщение Layer
+        std::string Encode() const;
+
+    private:
+        std::string name_;
+        uint32_t extent_;
+        std::string features_; // закодированные поля features
+        std::vector<std::string> keys_;
+        std::map<std::string, uint32_t, std::less<>> key_indexes_;
+        std::vector<Value> values_;
+        std::map<Value, uint32_t> value_indexes_;
+
+        void AddFeature(uint64_t id, uint32_t type, const std::vector<uint32_t>& geometry, const Tags& tags);
+    };
+
+    // Тайл из непустых слоёв. Пустой тайл — пустая строка
+    std::string EncodeTile(const std::vector<Layer>& layers);
+
+}//namespace vector_tile